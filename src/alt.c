@@ -4,7 +4,7 @@
 #include "internal.h"
 
 Guard* alt_guardcreate(enum GuardType type, uint64_t usec, 
-                       Chan *chan, void *data, size_t size)
+                       void *obj, void *data, size_t size)
 {
     /* calloc GUARD struct */
     Guard *guard;
@@ -13,6 +13,16 @@ Guard* alt_guardcreate(enum GuardType type, uint64_t usec,
         return NULL;
     }
 
+    alt_guardinit(guard, type, usec, obj, data, size);
+
+    return guard;
+}
+
+void alt_guardinit(Guard *guard, enum GuardType type, uint64_t usec,
+                   void *obj, void *data, size_t size)
+{
+    ASSERT_NOTNULL(guard);
+
     /* set common members */
     guard->type = type;
     guard->key  = -1;
@@ -24,7 +34,8 @@ Guard* alt_guardcreate(enum GuardType type, uint64_t usec,
     case GUARD_TIME:
         guard->usec = usec;
         break;
-    case GUARD_CHAN:
+    case GUARD_CHAN: {
+        Chan *chan = obj;
         ASSERT_NOTNULL(chan);
         guard->chan = chan;
 
@@ -32,6 +43,7 @@ Guard* alt_guardcreate(enum GuardType type, uint64_t usec,
         guard->ch_end.data  = data;
         guard->ch_end.chan  = chan;
         guard->ch_end.guard = guard;
+        guard->ch_end.alt   = NULL;
 
         guard->data.ptr  = data;
         guard->data.size = size;
@@ -39,8 +51,46 @@ Guard* alt_guardcreate(enum GuardType type, uint64_t usec,
         guard->in_chan = 0;
         break;
     }
+    case GUARD_CALL: {
+        Call *call = obj;
+        ASSERT_NOTNULL(call);
+        guard->call = call;
 
-    return guard;
+        guard->call_end.type  = CALL_ALTER;
+        guard->call_end.req   = data;
+        guard->call_end.call  = call;
+        guard->call_end.guard = guard;
+
+        guard->data.ptr  = data;
+        guard->data.size = size;
+
+        guard->in_call = 0;
+        break;
+    }
+    case GUARD_BAR: {
+        Barrier *bar = obj;
+        ASSERT_NOTNULL(bar);
+        guard->bar = bar;
+
+        guard->in_bar = 0;
+        break;
+    }
+    case GUARD_FUTURE: {
+        Future *fut = obj;
+        ASSERT_NOTNULL(fut);
+        guard->fut = fut;
+
+        guard->data.ptr  = data;
+        guard->data.size = size;
+
+        guard->in_fut = 0;
+        break;
+    }
+    case GUARD_FD:
+        /* fd and events are set by io_guardinit */
+        guard->in_io = 0;
+        break;
+    }
 }
 
 void alt_guardfree(Guard *guard)
@@ -59,6 +109,7 @@ void alt_init(Alt *alt)
     alt->key_count   = 0;
     alt->is_accepted = 0;
     alt->winner      = NULL;
+    alt->winner_end  = NULL;
 
     alt->ready.num    = 0;
     alt->ready.guards = NULL;
@@ -76,7 +127,8 @@ void alt_cleanup(Alt *alt)
     if (!alt) return;
 
     Guard *guard;
-    TAILQ_FOREACH(guard, &alt->guards.Q, node) {
+    while ((guard = TAILQ_FIRST(&alt->guards.Q))) {
+        TAILQ_REMOVE(&alt->guards.Q, guard, node);
         alt_guardfree(guard);
     }
     if (alt->ready.guards) {
@@ -101,11 +153,16 @@ void alt_addguard(Alt *alt, Guard *guard)
    
     /* Only keep TimeGuard with lowest usce */
     if (guard->type == GUARD_TIME) {
-       if (alt->guard_time && (guard->usec >= alt->guard_time->usec)) {
-           PDEBUG("AltGuard %d inactive\n", key);
-           return;
+        if (alt->guard_time && (guard->usec >= alt->guard_time->usec)) {
+            PDEBUG("AltGuard %d inactive\n", key);
+            alt_guardfree(guard);
+            return;
+        }
+        if (alt->guard_time) {
+            --alt->guards.num;
+            TAILQ_REMOVE(&alt->guards.Q, alt->guard_time, node);
+            alt_guardfree(alt->guard_time);
         }
-        alt_guardfree(alt->guard_time);
         alt->guard_time = guard;
     } 
 
@@ -113,6 +170,7 @@ void alt_addguard(Alt *alt, Guard *guard)
     guard->key = key;
     guard->alt = alt; 
     guard->ch_end.proc = alt->proc;
+    guard->call_end.proc = alt->proc;
 
     ++alt->guards.num;
     TAILQ_INSERT_TAIL(&alt->guards.Q, guard, node);
@@ -134,6 +192,28 @@ int alt_accept(Guard *guard)
     return 0;
 }
 
+/*
+ * Accepts the ALT of a chan end, which is either that of its
+ * guard, or a replicated ALT where the end itself wins.
+ */
+int alt_acceptend(ChanEnd *end)
+{
+    ASSERT_NOTNULL(end);
+
+    if (end->guard) {
+        return alt_accept(end->guard);
+    }
+
+    Alt *alt = end->alt;
+    if (alt->is_accepted == 0) {
+        PDEBUG("alt_acceptend succeded!\n");
+        alt->is_accepted = 1;
+        alt->winner_end = end;
+        return 1;
+    }
+    return 0;
+}
+
 int alt_enable(Guard *guard)
 {
     ASSERT_NOTNULL(guard);
@@ -144,11 +224,26 @@ int alt_enable(Guard *guard)
         scheduler_addaltsleep(guard);
         return 0;
     case GUARD_CHAN: 
-        if (chan_altenable(guard->chan, guard)) {
+        if (chan_altenable(guard->chan, &guard->ch_end)) {
             return 1;
         }
         guard->in_chan = 1;
         return 0;
+    case GUARD_CALL:
+        if (call_altenable(guard->call, guard)) {
+            return 1;
+        }
+        guard->in_call = 1;
+        return 0;
+    case GUARD_BAR:
+        /* barrier_altenable sets in_bar */
+        return barrier_altenable(guard->bar, guard);
+    case GUARD_FUTURE:
+        /* future_altenable sets in_fut */
+        return future_altenable(guard->fut, guard);
+    case GUARD_FD:
+        /* io_altenable sets in_io */
+        return io_altenable(guard);
     }
     return 0;
 }
@@ -164,25 +259,70 @@ void alt_disable(Guard *guard)
         scheduler_remaltsleep(guard);
         return;
     case GUARD_CHAN:
-        if (guard->in_chan) {
-            chan_altdisable(guard->chan, guard);
+        /* in_chan is 2 if the chan was poisoned */
+        if (guard->in_chan == 1) {
+            chan_altdisable(guard->chan, &guard->ch_end);
+        }
+        return;
+    case GUARD_CALL:
+        if (guard->in_call) {
+            call_altdisable(guard->call, guard);
+        }
+        return;
+    case GUARD_BAR:
+        /* in_bar is 2 if the barrier allready completed */
+        if (guard->in_bar == 1) {
+            barrier_altdisable(guard->bar, guard);
+        }
+        return;
+    case GUARD_FUTURE:
+        /* in_fut is 2 if the future completed while enabled */
+        if (guard->in_fut == 1) {
+            future_altdisable(guard->fut, guard);
+        }
+        return;
+    case GUARD_FD:
+        /* in_io is 2 if the fd became ready while enabled */
+        if (guard->in_io == 1) {
+            io_altdisable(guard);
         }
         return;
     }
 }
 
-void alt_complete(Alt *alt, Guard *guard)
+/*
+ * Completes the operation of the winning guard, and returns
+ * PROXC_EPOISON if its chan was poisoned, else 0.
+ */
+int alt_complete(Alt *alt, Guard *guard)
 {
     ASSERT_NOTNULL(alt);
     ASSERT_NOTNULL(guard);
 
-    if (guard->type == GUARD_CHAN && !guard->in_chan) {
-        chan_altread(guard->chan, guard, guard->data.size);
+    int ret = 0;
+    /* in_chan is 2 if the chan was poisoned while enabled */
+    if (guard->type == GUARD_CHAN && guard->in_chan == 2) {
+        ret = PROXC_EPOISON;
+    }
+    else if (guard->type == GUARD_CHAN && !guard->in_chan) {
+        if (chan_altread(guard->chan, &guard->ch_end, guard->data.size) < 0) {
+            ret = PROXC_EPOISON;
+        }
+    }
+    else if (guard->type == GUARD_CALL && !guard->in_call) {
+        call_altaccept(guard->call, guard, guard->data.size);
+    }
+    else if (guard->type == GUARD_BAR && !guard->in_bar) {
+        barrier_altsync(guard->bar, guard);
+    }
+    else if (guard->type == GUARD_FUTURE) {
+        future_altread(guard->fut, guard, guard->data.size);
     }
 
     if (alt->ready.num > 0) {
         proc_yield(alt->proc);
     }
+    return ret;
 }
 
 void alt_choose(Alt *alt)
@@ -199,8 +339,26 @@ void alt_choose(Alt *alt)
     /* wait until on of the chan_ends reschedules ALT */
     else if (!alt->is_accepted) {
         PDEBUG("No ready Guards, yield\n");
+        alt->proc->alt   = alt;
         alt->proc->state = PROC_ALTWAIT;
         proc_yield(alt->proc);
+        alt->proc->alt   = NULL;
+    }
+}
+
+/*
+ * Called when the PROC of a waiting ALT is cancelled, which
+ * accepts the ALT with no winner.
+ */
+void alt_cancel(Alt *alt)
+{
+    ASSERT_NOTNULL(alt);
+
+    if (alt->is_accepted == 0) {
+        PDEBUG("ALT cancelled\n");
+        alt->is_accepted = 1;
+        alt->winner = NULL;
+        scheduler_addready(alt->proc);
     }
 }
 
@@ -210,10 +368,17 @@ int alt_select(Alt *alt)
 
     PDEBUG("alt_select finding case\n");
 
-    alt->ready.num    = 0;
-    alt->ready.guards = malloc(sizeof(Guard *) * alt->guards.num);
-    if (UNLIKELY(!alt->ready.guards)) {
-        PANIC("Allocation failed for ALT\n");
+    if (UNLIKELY(proc_cancelpoint(alt->proc))) {
+        return PROXC_ECANCEL;
+    }
+
+    alt->ready.num = 0;
+    /* the ready array may allready be provided */
+    if (!alt->ready.guards) {
+        alt->ready.guards = malloc(sizeof(Guard *) * alt->guards.num);
+        if (UNLIKELY(!alt->ready.guards)) {
+            PANIC("Allocation failed for ALT\n");
+        }
     }
     
     Guard *guard;
@@ -227,15 +392,130 @@ int alt_select(Alt *alt)
     /* determine which Guard is winner, set in alt->winner */
     alt_choose(alt);
     
-    /* from here, a winner guard is set in alt->winner */
-    ASSERT_NOTNULL(alt->winner);
-
+    /* from here, a winner guard is set in alt->winner, */
+    /* or none if cancelled */
     TAILQ_FOREACH_REVERSE(guard, &alt->guards.Q, GuardQ, node) {
         alt_disable(guard);
     }
+    if (UNLIKELY(!alt->winner)) {
+        return PROXC_ECANCEL;
+    }
 
-    alt_complete(alt, alt->winner); 
+    /* a poisoned chan is reported by the key of its guard */
+    if (UNLIKELY(alt_complete(alt, alt->winner) == PROXC_EPOISON)) {
+        alt->proc->alt_poisoned = alt->winner->key;
+        return PROXC_EPOISON;
+    }
 
     /* from here, winner contains the winning GUARD */
     return alt->winner->key;
 }
+
+/*
+ * Replicated ALT over num chans, where a NULL chan is inactive.
+ * Only a ChanEnd and index per active chan is stored, in one
+ * array, as the guards of ALT are not needed for chans only.
+ * Returns the index of the chan read from, PROXC_EPOISON as ALT,
+ * or PROXC_EINVAL if no chan is active.
+ */
+int alt_selectchans(Chan **chans, size_t num, void *out, size_t size)
+{
+    ASSERT_NOTNULL(chans);
+
+    Alt alt;
+    alt_init(&alt);
+    Proc *proc = alt.proc;
+
+    if (UNLIKELY(proc_cancelpoint(proc))) {
+        return PROXC_ECANCEL;
+    }
+
+    size_t num_active = 0;
+    for (size_t i = 0; i < num; ++i) {
+        num_active += (chans[i] != NULL);
+    }
+    if (UNLIKELY(num_active == 0)) {
+        return PROXC_EINVAL;
+    }
+
+    AltEnd *ends;
+    if (!(ends = malloc(sizeof(AltEnd) * num_active))) {
+        PERROR("malloc failed for AltEnds\n");
+        return PROXC_ENOMEM;
+    }
+
+    /* status of an end is 1 if ready when enabled, else 0 */
+    /* while in the altQ of its chan, until poisoned */
+    size_t num_ready = 0;
+    AltEnd *end = ends;
+    for (size_t i = 0; i < num; ++i) {
+        if (!chans[i]) {
+            continue;
+        }
+        ASSERT_EQ(size, chans[i]->data_size);
+        end->ch_end = (ChanEnd){
+            .type   = CHAN_ALTER,
+            .data   = out,
+            .chan   = chans[i],
+            .proc   = proc,
+            .guard  = NULL,
+            .alt    = &alt,
+            .status = 0
+        };
+        end->index = i;
+        if (chan_altenable(chans[i], &end->ch_end)) {
+            end->ch_end.status = 1;
+            ++num_ready;
+        }
+        ++end;
+    }
+
+    ChanEnd *winner = NULL;
+    if (num_ready > 0) {
+        /* for now, choose randomly for N > 1 */
+        size_t nth = (num_ready > 1) ? (size_t)rand() % num_ready : 0;
+        for (end = ends; ; ++end) {
+            if (end->ch_end.status == 1 && nth-- == 0) {
+                break;
+            }
+        }
+        winner = &end->ch_end;
+    }
+    else {
+        /* wait until a writer or poison accepts an end */
+        proc->alt   = &alt;
+        proc->state = PROC_ALTWAIT;
+        proc_yield(proc);
+        proc->alt   = NULL;
+        winner = alt.winner_end;
+    }
+
+    for (size_t i = num_active; i-- > 0; ) {
+        if (ends[i].ch_end.status == 0) {
+            chan_altdisable(ends[i].ch_end.chan, &ends[i].ch_end);
+        }
+    }
+
+    int key;
+    if (UNLIKELY(!winner)) {
+        key = PROXC_ECANCEL;
+    }
+    else {
+        /* ch_end is the first member of AltEnd */
+        key = (int)((AltEnd *)winner)->index;
+        /* a ready end reads, and a woken end was written to */
+        int ret = (winner->status == 1)
+                ? chan_altread(winner->chan, winner, size)
+                : winner->status;
+        if (UNLIKELY(ret == PROXC_EPOISON)) {
+            proc->alt_poisoned = key;
+            key = PROXC_EPOISON;
+        }
+    }
+    free(ends);
+
+    if (num_ready > 0) {
+        proc_yield(proc);
+    }
+    return key;
+}
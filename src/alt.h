@@ -26,6 +26,31 @@ struct Guard {
         size_t  size;
     } data;
     int  in_chan;
+
+    /* Call Guard */
+    Call     *call;
+    CallEnd  call_end;
+    int  in_call;
+
+    /* Barrier Guard */
+    Barrier  *bar;
+    TAILQ_ENTRY(Guard)  bar_node;
+    int  in_bar;
+
+    /* Future Guard */
+    Future  *fut;
+    TAILQ_ENTRY(Guard)  fut_node;
+    int  in_fut;
+
+    /* Fd Guard */
+    IoWait  io_wait;
+    int  in_io;
+};
+
+/* a chan of a replicated ALT, and its index in the chans */
+struct AltEnd {
+    ChanEnd  ch_end;
+    size_t   index;
 };
 
 struct Alt {
@@ -33,6 +58,8 @@ struct Alt {
 
     int    is_accepted;
     Guard  *winner;
+    /* winner of a replicated ALT, which has no guards */
+    ChanEnd  *winner_end;
 
     struct {
         int   num;
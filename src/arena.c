@@ -0,0 +1,73 @@
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+
+#include "internal.h"
+
+Arena* arena_create(size_t size)
+{
+    /* room for size bytes, as allocations are rounded up */
+    size = (size + 15) & ~(size_t)15;
+
+    Arena *arena;
+    if (!(arena = malloc(sizeof(Arena) + size))) {
+        PERROR("malloc failed for Arena\n");
+        return NULL;
+    }
+
+    arena->size = size;
+    arena->used = 0;
+    arena->live = 0;
+    arena->is_current = 0;
+
+    return arena;
+}
+
+void arena_free(Arena *arena)
+{
+    if (!arena) return;
+
+    free(arena);
+}
+
+/*
+ * Bump allocates size bytes, 16 byte aligned, and
+ * returns NULL if there is no room left in arena.
+ */
+void* arena_alloc(Arena *arena, size_t size)
+{
+    ASSERT_NOTNULL(arena);
+
+    size = (size + 15) & ~(size_t)15;
+    if (arena->size - arena->used < size) {
+        return NULL;
+    }
+
+    void *ptr = arena->buf + arena->used;
+    arena->used += size;
+    arena->live++;
+
+    return ptr;
+}
+
+/*
+ * Releases one allocation, and returns how many are left. There
+ * is no per allocation free, the arena is reset or freed as a
+ * whole when none are left.
+ */
+size_t arena_release(Arena *arena)
+{
+    ASSERT_NOTNULL(arena);
+    ASSERT_TRUE(arena->live > 0);
+
+    return --arena->live;
+}
+
+void arena_reset(Arena *arena)
+{
+    ASSERT_NOTNULL(arena);
+    ASSERT_EQ(arena->live, 0);
+
+    arena->used = 0;
+}
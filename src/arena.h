@@ -0,0 +1,22 @@
+
+#ifndef ARENA_H__
+#define ARENA_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "internal.h"
+
+struct Arena {
+    /* bytes in buf, and bytes handed out */
+    size_t  size;
+    size_t  used;
+    /* allocations not yet released */
+    size_t  live;
+    /* set while allocations are made from it */
+    int     is_current;
+
+    unsigned char  buf[] __attribute__((aligned(16)));
+};
+
+#endif /* ARENA_H__ */
@@ -0,0 +1,225 @@
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+
+#include "internal.h"
+
+Barrier* barrier_create(size_t enrolled)
+{
+    Barrier *bar;
+
+    /* alloc BARRIER struct */
+    if (!(bar = malloc(sizeof(Barrier)))) {
+        PERROR("malloc failed for Barrier\n");
+        return NULL;
+    }
+
+    PDEBUG("BARRIER with %zu enrolled created\n", enrolled);
+
+    /* set BARRIER members */
+    bar->enrolled = enrolled;
+    bar->count    = enrolled;
+    TAILQ_INIT(&bar->waitQ);
+    TAILQ_INIT(&bar->altQ);
+
+    return bar;
+}
+
+void barrier_free(Barrier *bar)
+{
+    if (!bar) return;
+
+    PDEBUG("BARRIER closed\n");
+    free(bar);
+}
+
+/*
+ * An alting PROC counts as synced while its guard is enabled.
+ * If the ALT has allready been accepted by another guard, it
+ * will withdraw from the barrier, so undo its sync here.
+ */
+static
+void _barrier_prune(Barrier *bar)
+{
+    Guard *guard, *next;
+    for (guard = TAILQ_FIRST(&bar->altQ); guard; guard = next) {
+        next = TAILQ_NEXT(guard, bar_node);
+        if (guard->alt->is_accepted) {
+            TAILQ_REMOVE(&bar->altQ, guard, bar_node);
+            guard->in_bar = 0;
+            ++bar->count;
+        }
+    }
+}
+
+/*
+ * Called when count has reached zero. Accepts all alting PROCs,
+ * and releases all waiting PROCs onto readyQ in one batch.
+ * Returns 0 if an alting PROC withdrew, and the phase is not done.
+ */
+static
+int _barrier_complete(Barrier *bar)
+{
+    _barrier_prune(bar);
+    if (bar->count > 0) {
+        return 0;
+    }
+
+    PDEBUG("BARRIER complete, releasing PROCs\n");
+
+    Guard *guard;
+    while ((guard = TAILQ_FIRST(&bar->altQ))) {
+        TAILQ_REMOVE(&bar->altQ, guard, bar_node);
+        guard->in_bar = 2;
+        if (alt_accept(guard)) {
+            Proc *alt_proc = guard->alt->proc;
+            if (alt_proc->state == PROC_ALTWAIT) {
+                scheduler_addready(alt_proc);
+            }
+        }
+    }
+
+    Proc *proc = TAILQ_FIRST(&bar->waitQ);
+    if (proc) {
+        Scheduler *sched = proc->sched;
+        TAILQ_FOREACH(proc, &bar->waitQ, readyQ_next) {
+            proc->state = PROC_READY;
+        }
+        TAILQ_CONCAT(&sched->readyQ, &bar->waitQ, readyQ_next);
+    }
+
+    /* ready for next phase */
+    bar->count = bar->enrolled;
+    return 1;
+}
+
+void barrier_enroll(Barrier *bar)
+{
+    ASSERT_NOTNULL(bar);
+
+    // << acquire lock <<
+    ++bar->enrolled;
+    ++bar->count;
+    // >> release lock >>
+}
+
+void barrier_resign(Barrier *bar)
+{
+    ASSERT_NOTNULL(bar);
+    ASSERT_TRUE(bar->enrolled > 0);
+
+    // << acquire lock <<
+    --bar->enrolled;
+    if (--bar->count == 0 && bar->enrolled > 0) {
+        /* the resigning PROC was the last one missing */
+        _barrier_complete(bar);
+    }
+    // >> release lock >>
+}
+
+int barrier_sync(Barrier *bar)
+{
+    ASSERT_NOTNULL(bar);
+    ASSERT_TRUE(bar->count > 0);
+
+    Proc *proc = proc_self();
+
+    // << acquire lock <<
+
+    if (--bar->count == 0 && _barrier_complete(bar)) {
+
+        // >> release lock >>
+
+        PDEBUG("BARRIER sync, last PROC\n");
+        return 1;
+    }
+
+    /* a cancelled PROC does not wait, so undo its sync */
+    if (UNLIKELY(proc->is_cancelled)) {
+        ++bar->count;
+
+        // >> release lock >>
+
+        proc_cancelpoint(proc);
+        return PROXC_ECANCEL;
+    }
+
+    TAILQ_INSERT_TAIL(&bar->waitQ, proc, readyQ_next);
+
+    // >> release lock >>
+
+    PDEBUG("BARRIER sync, waiting on others\n");
+
+    /* yield until last PROC syncs */
+    proc->wait_obj    = bar;
+    proc->wait_status = 1;
+    proc->state = PROC_BARWAIT;
+    proc_yield(proc);
+    proc->wait_obj = NULL;
+    /* here, all enrolled PROCs have synced, or cancelled */
+    return proc->wait_status;
+}
+
+/*
+ * Called when a PROC waiting on bar is cancelled, which withdraws
+ * its sync of this phase, but stays enrolled.
+ */
+void barrier_cancel(Barrier *bar, Proc *proc)
+{
+    ASSERT_NOTNULL(bar);
+    ASSERT_NOTNULL(proc);
+
+    // << acquire lock <<
+    TAILQ_REMOVE(&bar->waitQ, proc, readyQ_next);
+    ++bar->count;
+    // >> release lock >>
+
+    PDEBUG("BARRIER sync cancelled\n");
+    proc->wait_status = PROXC_ECANCEL;
+    scheduler_addready(proc);
+}
+
+int barrier_altenable(Barrier *bar, Guard *guard)
+{
+    ASSERT_NOTNULL(bar);
+    ASSERT_NOTNULL(guard);
+
+    _barrier_prune(bar);
+    /* everyone else has synced, only this one is missing */
+    if (bar->count == 1) {
+        return 1;
+    }
+
+    TAILQ_INSERT_TAIL(&bar->altQ, guard, bar_node);
+    guard->in_bar = 1;
+    --bar->count;
+
+    return 0;
+}
+
+void barrier_altdisable(Barrier *bar, Guard *guard)
+{
+    ASSERT_NOTNULL(bar);
+    ASSERT_NOTNULL(guard);
+    ASSERT_EQ(bar, guard->bar);
+
+    TAILQ_REMOVE(&bar->altQ, guard, bar_node);
+    guard->in_bar = 0;
+    ++bar->count;
+}
+
+void barrier_altsync(Barrier *bar, Guard *guard)
+{
+    ASSERT_NOTNULL(bar);
+    ASSERT_NOTNULL(guard);
+
+    // << acquire lock <<
+
+    int ret;
+    --bar->count;
+    ret = _barrier_complete(bar);
+    ASSERT_TRUE(ret);
+
+    // >> release lock >>
+}
@@ -0,0 +1,22 @@
+
+#ifndef BARRIER_H__
+#define BARRIER_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "internal.h"
+
+struct Barrier {
+    /* number of enrolled PROCs, and how many */
+    /* of them has yet to sync this phase */
+    size_t  enrolled;
+    size_t  count;
+
+    /* synced PROCs, linked through readyQ_next */
+    struct ProcQ   waitQ;
+    /* alting PROCs, counted as synced while enabled */
+    struct GuardQ  altQ;
+};
+
+#endif /* BARRIER_H__ */
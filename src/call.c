@@ -0,0 +1,278 @@
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+
+#include "internal.h"
+
+Call* call_create(size_t req_size, size_t resp_size)
+{
+    Call *call;
+
+    /* alloc CALL struct */
+    if (!(call = malloc(sizeof(Call)))) {
+        PERROR("malloc failed for Call\n");
+        return NULL;
+    }
+
+    PDEBUG("CALL of req size %zu and resp size %zu created\n", req_size, resp_size);
+
+    /* set CALL members */
+    call->req_size  = req_size;
+    call->resp_size = resp_size;
+    TAILQ_INIT(&call->endQ);
+    TAILQ_INIT(&call->altQ);
+    TAILQ_INIT(&call->acceptQ);
+
+    return call;
+}
+
+void call_free(Call *call)
+{
+    if (!call) return;
+
+    PDEBUG("CALL closed\n");
+    free(call);
+}
+
+static inline
+void _call_accepted(Call *call, CallEnd *client, Proc *server, void *req)
+{
+    /* copy over request, and keep client until server replies */
+    copydata(req, client->req, call->req_size);
+    client->server = server;
+    TAILQ_INSERT_TAIL(&call->acceptQ, client, node);
+}
+
+/*
+ * The client is parked exactly once per call, from the request
+ * is enqueued until the server replies. The request rendezvous
+ * never resumes the client, as opposed to a request channel
+ * followed by a reply channel. A cancelled client does not wait,
+ * and returns PROXC_ECANCEL.
+ */
+int call_call(Call *call, void *req, size_t req_size, void *resp, size_t resp_size)
+{
+    ASSERT_NOTNULL(call);
+    ASSERT_EQ(req_size, call->req_size);
+    ASSERT_EQ(resp_size, call->resp_size);
+
+    Proc *proc = proc_self();
+    struct CallEnd client_end = {
+        .type   = CALL_CLIENT,
+        .req    = req,
+        .resp   = resp,
+        .call   = call,
+        .proc   = proc,
+        .server = NULL,
+        .guard  = NULL
+    };
+
+    // << acquire lock <<
+
+    CallEnd *first;
+
+    first = TAILQ_FIRST(&call->altQ);
+    if (first) {
+        if (alt_accept(first->guard)) {
+            _call_accepted(call, &client_end, first->proc, first->req);
+
+            // >> release lock >>
+
+            PDEBUG("CALL call, alting server found\n");
+            scheduler_addready(first->proc);
+            goto wait_reply;
+        }
+    }
+
+    first = TAILQ_FIRST(&call->endQ);
+    /* if endQ not empty and contains servers */
+    if (first && first->type == CALL_SERVER) {
+        TAILQ_REMOVE(&call->endQ, first, node);
+        _call_accepted(call, &client_end, first->proc, first->req);
+
+        // >> release lock >>
+
+        PDEBUG("CALL call, server found\n");
+        scheduler_addready(first->proc);
+        goto wait_reply;
+    }
+
+    if (UNLIKELY(proc_cancelpoint(proc))) {
+        // >> release lock >>
+        return PROXC_ECANCEL;
+    }
+
+    /* if not, endQ is empty or contains clients, enqueue self */
+    TAILQ_INSERT_TAIL(&call->endQ, &client_end, node);
+
+    // >> release lock >>
+
+    PDEBUG("CALL call, no servers, enqueue\n");
+
+wait_reply:
+    /* yield until server replies */
+    proc->call_end    = &client_end;
+    proc->wait_status = 1;
+    proc->state = PROC_CALLWAIT;
+    proc_yield(proc);
+    proc->call_end = NULL;
+    /* here, call is complete or cancelled */
+    return proc->wait_status;
+}
+
+int call_accept(Call *call, void *req, size_t size)
+{
+    ASSERT_NOTNULL(call);
+    ASSERT_EQ(size, call->req_size);
+
+    Proc *proc = proc_self();
+
+    // << acquire lock <<
+
+    CallEnd *first = TAILQ_FIRST(&call->endQ);
+
+    /* if endQ not empty and contains clients */
+    if (first && first->type == CALL_CLIENT) {
+        TAILQ_REMOVE(&call->endQ, first, node);
+        _call_accepted(call, first, proc, req);
+
+        // >> release lock >>
+
+        PDEBUG("CALL accept, client found\n");
+        return 1;
+    }
+
+    if (UNLIKELY(proc_cancelpoint(proc))) {
+        // >> release lock >>
+        return PROXC_ECANCEL;
+    }
+
+    /* if not, endQ is empty or contains servers, enqueue self */
+    struct CallEnd server_end = {
+        .type   = CALL_SERVER,
+        .req    = req,
+        .resp   = NULL,
+        .call   = call,
+        .proc   = proc,
+        .server = NULL,
+        .guard  = NULL
+    };
+    TAILQ_INSERT_TAIL(&call->endQ, &server_end, node);
+
+    // >> release lock >>
+
+    PDEBUG("CALL accept, no clients, enqueue\n");
+
+    /* yield until a client reschedules this end */
+    proc->call_end    = &server_end;
+    proc->wait_status = 1;
+    proc->state = PROC_CALLWAIT;
+    proc_yield(proc);
+    proc->call_end = NULL;
+    /* here, request is copied over, or cancelled */
+    return proc->wait_status;
+}
+
+int call_reply(Call *call, void *resp, size_t size)
+{
+    ASSERT_NOTNULL(call);
+    ASSERT_EQ(size, call->resp_size);
+
+    Proc *proc = proc_self();
+
+    // << acquire lock <<
+
+    /* find the client accepted by this server */
+    CallEnd *client;
+    TAILQ_FOREACH(client, &call->acceptQ, node) {
+        if (client->server == proc) {
+            break;
+        }
+    }
+    if (UNLIKELY(!client)) {
+
+        // >> release lock >>
+
+        PDEBUG("CALL reply, no accepted client\n");
+        return 0;
+    }
+    TAILQ_REMOVE(&call->acceptQ, client, node);
+
+    // >> release lock >>
+
+    PDEBUG("CALL reply, resume client\n");
+
+    copydata(client->resp, resp, call->resp_size);
+    scheduler_addready(client->proc);
+    return 1;
+}
+
+int call_altenable(Call *call, Guard *guard)
+{
+    ASSERT_NOTNULL(call);
+    ASSERT_NOTNULL(guard);
+
+    CallEnd *cl_end = TAILQ_FIRST(&call->endQ);
+    if (cl_end && cl_end->type == CALL_CLIENT) {
+        return 1;
+    }
+
+    TAILQ_INSERT_TAIL(&call->altQ, &guard->call_end, node);
+
+    return 0;
+}
+
+void call_altdisable(Call *call, Guard *guard)
+{
+    ASSERT_NOTNULL(call);
+    ASSERT_NOTNULL(guard);
+    ASSERT_EQ(call, guard->call);
+
+    TAILQ_REMOVE(&call->altQ, &guard->call_end, node);
+}
+
+void call_altaccept(Call *call, Guard *guard, size_t size)
+{
+    ASSERT_NOTNULL(call);
+    ASSERT_NOTNULL(guard);
+    ASSERT_EQ(size, call->req_size);
+
+    // << acquire lock <<
+
+    CallEnd *first = TAILQ_FIRST(&call->endQ);
+    if (UNLIKELY(first->type != CALL_CLIENT)) {
+        PANIC("Altaccept called on call with no clients\n");
+    }
+
+    TAILQ_REMOVE(&call->endQ, first, node);
+    _call_accepted(call, first, guard->alt->proc, guard->data.ptr);
+
+    // >> release lock >>
+}
+
+/*
+ * Called when the PROC of a waiting end is cancelled. A client
+ * allready accepted is dropped from acceptQ, and the reply of
+ * its server then finds no client.
+ */
+void call_cancel(CallEnd *end)
+{
+    ASSERT_NOTNULL(end);
+
+    Call *call = end->call;
+
+    // << acquire lock <<
+    if (end->server) {
+        TAILQ_REMOVE(&call->acceptQ, end, node);
+    }
+    else {
+        TAILQ_REMOVE(&call->endQ, end, node);
+    }
+    // >> release lock >>
+
+    PDEBUG("CALL operation cancelled\n");
+    end->proc->wait_status = PROXC_ECANCEL;
+    scheduler_addready(end->proc);
+}
@@ -0,0 +1,41 @@
+
+#ifndef CALL_H__
+#define CALL_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "internal.h"
+
+struct CallEnd {
+    enum {
+        CALL_CLIENT,
+        CALL_SERVER,
+        CALL_ALTER,
+    } type;
+
+    void  *req;
+    void  *resp;
+
+    struct Call  *call;
+
+    struct Proc   *proc;
+    struct Proc   *server;
+    struct Guard  *guard;
+
+    TAILQ_ENTRY(CallEnd)  node;
+};
+
+struct Call {
+    size_t  req_size;
+    size_t  resp_size;
+
+    /* waiting clients or accepting servers */
+    struct CallEndQ  endQ;
+    /* alting servers */
+    struct CallEndQ  altQ;
+    /* accepted clients, waiting on reply */
+    struct CallEndQ  acceptQ;
+};
+
+#endif /* CALL_H__ */
@@ -6,6 +6,8 @@
 
 #include "internal.h"
 
+#define CHAN_NO_TIMEOUT  UINT64_MAX
+
 Chan* chan_create(size_t data_size)
 {
     Chan *chan;
@@ -19,7 +21,10 @@ Chan* chan_create(size_t data_size)
     PDEBUG("CHAN of type size %zu created\n", data_size);
 
     /* set CHAN members */
-    chan->data_size = data_size;
+    chan->data_size   = data_size;
+    chan->is_poisoned = 0;
+    chan->sched       = scheduler_current();
+    chan->source      = NULL;
     TAILQ_INIT(&chan->endQ);
     TAILQ_INIT(&chan->altQ);
 
@@ -30,24 +35,112 @@ void chan_free(Chan *chan)
 {
     if (!chan) return;
 
+    /* no end may be left referring to chan */
+    chan_poison(chan);
+    if (chan->source) {
+        source_free(chan->source);
+    }
+
     PDEBUG("CHAN closed\n");
     free(chan);
 }
 
+/*
+ * Resumes the PROC of a queued reader or writer, and removes
+ * the timer of a timed operation.
+ */
 static inline
-void _chan_copydata(void *dst, void *src, size_t size)
+void _chan_resume(ChanEnd *end, int status)
 {
-    switch (size) {
-    case 0:    /* do nothing */                   break;
-    case 1:   *(uint8_t *)dst =  *(uint8_t *)src; break;
-    case 2:  *(uint16_t *)dst = *(uint16_t *)src; break;
-    case 4:  *(uint32_t *)dst = *(uint32_t *)src; break;
-    case 8:  *(uint64_t *)dst = *(uint64_t *)src; break;
-    default: memcpy(dst, src, size); break;
+    Proc *proc = end->proc;
+    if (proc->sleep_us > 0) {
+        scheduler_remsleep(proc);
+        proc->sleep_us = 0;
     }
+    end->status = status;
+    scheduler_addready(proc);
 }
 
-int chan_write(Chan *chan, void *data, size_t size)
+/*
+ * Enqueues end, and yields until the other end resumes it. For 
+ * a timed operation, the PROC is also inserted into the sleep
+ * tree of the scheduler, and chan_timeout dequeues the end.
+ * A cancelled PROC does not wait, and chan_cancel dequeues
+ * the end of a PROC cancelled while waiting.
+ * The deadline is only computed here, so the timed operations
+ * cost the same as the untimed when the other end is waiting.
+ */
+static inline
+int _chan_wait(Chan *chan, ChanEnd *end, uint64_t usec)
+{
+    Proc *proc = end->proc;
+
+    if (UNLIKELY(proc_cancelpoint(proc))) {
+        // >> release lock >>
+        return PROXC_ECANCEL;
+    }
+
+    if (usec != CHAN_NO_TIMEOUT) {
+        if (usec == 0) {
+            // >> release lock >>
+            return PROXC_ETIMEOUT;
+        }
+        proc->sleep_us = gettimestamp() + usec;
+        scheduler_addsleep(proc);
+    }
+    proc->ch_end = end;
+
+    TAILQ_INSERT_TAIL(&chan->endQ, end, node);
+
+    // >> release lock >>
+
+    /* yield until the other end reschedules this end */
+    proc->state = PROC_CHANWAIT;
+    proc_yield(proc);
+    proc->sleep_us = 0;
+    proc->ch_end   = NULL;
+    /* here, chan operation is complete, chan poisoned, timed out or cancelled */
+    return end->status;
+}
+
+/*
+ * Resumes all queued readers and writers with PROXC_EPOISON, 
+ * and all enabled ALTs. Every later operation on chan fails
+ * immediately, so a woken PROC never touches chan again.
+ */
+void chan_poison(Chan *chan)
+{
+    ASSERT_NOTNULL(chan);
+
+    // << acquire lock <<
+
+    chan->is_poisoned = 1;
+
+    ChanEnd *first;
+    while ((first = TAILQ_FIRST(&chan->endQ))) {
+        TAILQ_REMOVE(&chan->endQ, first, node);
+        _chan_resume(first, PROXC_EPOISON);
+    }
+
+    while ((first = TAILQ_FIRST(&chan->altQ))) {
+        TAILQ_REMOVE(&chan->altQ, first, node);
+        /* mark as removed, and the ALT will not try to read */
+        first->status = PROXC_EPOISON;
+        if (first->guard) {
+            first->guard->in_chan = 2;
+        }
+        if (first->proc->state == PROC_ALTWAIT && alt_acceptend(first)) {
+            scheduler_addready(first->proc);
+        }
+    }
+
+    // >> release lock >>
+
+    PDEBUG("CHAN poisoned\n");
+}
+
+static inline
+int _chan_write(Chan *chan, void *data, size_t size, uint64_t usec)
 {
     ASSERT_NOTNULL(chan);
     ASSERT_EQ(size, chan->data_size);
@@ -55,17 +148,22 @@ int chan_write(Chan *chan, void *data, size_t size)
     //Proc *proc = proc_self();
 
     // << acquire lock <<
+
+    if (UNLIKELY(chan->is_poisoned)) {
+        // >> release lock >>
+        return PROXC_EPOISON;
+    }
     
     ChanEnd *first;
     
     first = TAILQ_FIRST(&chan->altQ);
     if (first) {
-        if (alt_accept(first->guard)) {
+        if (alt_acceptend(first)) {
             
             // >> release lock >>
 
             //memcpy(first->data, data, size);
-            _chan_copydata(first->data, data, size);
+            copydata(first->data, data, size);
             scheduler_addready(first->proc);
             return 1;
         }
@@ -82,10 +180,10 @@ int chan_write(Chan *chan, void *data, size_t size)
         
         /* copy over data */
         //memcpy(first->data, data, size);
-        _chan_copydata(first->data, data, size);
+        copydata(first->data, data, size);
 
         /* resume reader */
-        scheduler_addready(first->proc);
+        _chan_resume(first, 1);
         //proc_yield(proc);
         return 1;
     }
@@ -93,26 +191,31 @@ int chan_write(Chan *chan, void *data, size_t size)
     /* if not, chanQ is empty or contains writers, enqueue self */
     Proc *proc = proc_self();
     struct ChanEnd reader_end = {
-        .type  = CHAN_WRITER,
-        .data  = data,
-        .chan  = chan,
-        .proc  = proc,
-        .guard = NULL
+        .type   = CHAN_WRITER,
+        .data   = data,
+        .chan   = chan,
+        .proc   = proc,
+        .guard  = NULL,
+        .status = 1
     };
-    TAILQ_INSERT_TAIL(&chan->endQ, &reader_end, node);
 
-    // >> release lock >>
-    
     PDEBUG("CHAN write, no readers, enqueue\n");
 
-    /* yield until reader reschedules this end */
-    proc->state = PROC_CHANWAIT;
-    proc_yield(proc);
-    /* here, chan operation is complete */
-    return 1;
+    return _chan_wait(chan, &reader_end, usec);
 }
 
-int chan_read(Chan *chan, void *data, size_t size)
+int chan_write(Chan *chan, void *data, size_t size)
+{
+    return _chan_write(chan, data, size, CHAN_NO_TIMEOUT);
+}
+
+int chan_timedwrite(Chan *chan, void *data, size_t size, uint64_t usec)
+{
+    return _chan_write(chan, data, size, usec);
+}
+
+static inline
+int _chan_read(Chan *chan, void *data, size_t size, uint64_t usec)
 {
     ASSERT_NOTNULL(chan);
     ASSERT_EQ(size, chan->data_size); 
@@ -121,6 +224,11 @@ int chan_read(Chan *chan, void *data, size_t size)
 
     // << acquire lock <<
 
+    if (UNLIKELY(chan->is_poisoned)) {
+        // >> release lock >>
+        return PROXC_EPOISON;
+    }
+
     ChanEnd *first = TAILQ_FIRST(&chan->endQ);
 
     /* if chanQ not empty and contains writers */
@@ -133,10 +241,10 @@ int chan_read(Chan *chan, void *data, size_t size)
         
         /* copy over data */
         //memcpy(data, first->data, size);
-        _chan_copydata(data, first->data, size);
+        copydata(data, first->data, size);
 
         /* resume writer */
-        scheduler_addready(first->proc);
+        _chan_resume(first, 1);
         //proc_yield(proc);
         return 1;
     }
@@ -144,56 +252,101 @@ int chan_read(Chan *chan, void *data, size_t size)
     /* if not, chanQ is empty or contains readers, enqueue self */
     Proc *proc = proc_self();
     struct ChanEnd writer_end = {
-        .type  = CHAN_READER,
-        .data  = data,
-        .chan  = chan,
-        .proc  = proc,
-        .guard = NULL
+        .type   = CHAN_READER,
+        .data   = data,
+        .chan   = chan,
+        .proc   = proc,
+        .guard  = NULL,
+        .status = 1
     };
-    TAILQ_INSERT_TAIL(&chan->endQ, &writer_end, node);
-    
-    // >> release lock >>
 
     PDEBUG("CHAN read, no writers, enqueue\n");
 
-    /* yield until writer reschedules this end */
-    proc->state = PROC_CHANWAIT;
-    proc_yield(proc);
-    /* here, chan operation is complete */
-    return 1;
+    return _chan_wait(chan, &writer_end, usec);
+}
+
+int chan_read(Chan *chan, void *data, size_t size)
+{
+    return _chan_read(chan, data, size, CHAN_NO_TIMEOUT);
 }
 
-int chan_altenable(Chan *chan, Guard *guard)
+int chan_timedread(Chan *chan, void *data, size_t size, uint64_t usec)
+{
+    return _chan_read(chan, data, size, usec);
+}
+
+/*
+ * Called by the scheduler when a timed operation times out.
+ */
+void chan_timeout(ChanEnd *end)
+{
+    ASSERT_NOTNULL(end);
+
+    // << acquire lock <<
+    TAILQ_REMOVE(&end->chan->endQ, end, node);
+    // >> release lock >>
+
+    PDEBUG("CHAN operation timed out\n");
+    end->status = PROXC_ETIMEOUT;
+}
+
+/*
+ * Called when the PROC of a waiting end is cancelled.
+ */
+void chan_cancel(ChanEnd *end)
+{
+    ASSERT_NOTNULL(end);
+
+    // << acquire lock <<
+    TAILQ_REMOVE(&end->chan->endQ, end, node);
+    // >> release lock >>
+
+    PDEBUG("CHAN operation cancelled\n");
+    _chan_resume(end, PROXC_ECANCEL);
+}
+
+int chan_altenable(Chan *chan, ChanEnd *end)
 {
     ASSERT_NOTNULL(chan);
-    ASSERT_NOTNULL(guard);
+    ASSERT_NOTNULL(end);
+
+    /* a poisoned chan is always ready, the following */
+    /* read returns the error */
+    if (chan->is_poisoned) {
+        return 1;
+    }
 
     ChanEnd *ch_end = TAILQ_FIRST(&chan->endQ);
     if (ch_end && ch_end->type == CHAN_WRITER) {
         return 1;
     }
 
-    TAILQ_INSERT_TAIL(&chan->altQ, &guard->ch_end, node);
+    TAILQ_INSERT_TAIL(&chan->altQ, end, node);
 
     return 0;
 }
 
-void chan_altdisable(Chan *chan, Guard *guard)
+void chan_altdisable(Chan *chan, ChanEnd *end)
 {
     ASSERT_NOTNULL(chan);
-    ASSERT_NOTNULL(guard);
-    ASSERT_EQ(chan, guard->chan);
+    ASSERT_NOTNULL(end);
+    ASSERT_EQ(chan, end->chan);
 
-    TAILQ_REMOVE(&chan->altQ, &guard->ch_end, node);
+    TAILQ_REMOVE(&chan->altQ, end, node);
 }
 
-void chan_altread(Chan *chan, Guard *guard, size_t size)
+int chan_altread(Chan *chan, ChanEnd *end, size_t size)
 {
     ASSERT_NOTNULL(chan);
-    ASSERT_NOTNULL(guard);
+    ASSERT_NOTNULL(end);
     ASSERT_EQ(size, chan->data_size);
 
     // << acquire lock <<
+
+    if (chan->is_poisoned) {
+        // >> release lock >>
+        return PROXC_EPOISON;
+    }
     
     ChanEnd *first = TAILQ_FIRST(&chan->endQ);
     if (UNLIKELY(first->type != CHAN_WRITER)) {
@@ -204,9 +357,10 @@ void chan_altread(Chan *chan, Guard *guard, size_t size)
 
     // >> release lock >>
 
-    //memcpy(guard->data.ptr, first->data, chan->data_size);
-    _chan_copydata(guard->data.ptr, first->data, chan->data_size);
+    //memcpy(end->data, first->data, chan->data_size);
+    copydata(end->data, first->data, chan->data_size);
 
-    scheduler_addready(first->proc);
+    _chan_resume(first, 1);
+    return 1;
 }
 
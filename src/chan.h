@@ -19,7 +19,12 @@ struct ChanEnd {
     struct Chan  *chan;
 
     struct Proc   *proc;
+    /* guard of an ALT end, or else its replicated ALT */
     struct Guard  *guard;
+    struct Alt    *alt;
+
+    /* result of operation, set when resumed */
+    int  status;
     
     TAILQ_ENTRY(ChanEnd)  node;
 };
@@ -28,6 +33,12 @@ struct Chan {
     uint64_t  id;
 
     size_t  data_size;
+    int     is_poisoned;
+
+    /* scheduler which opened this, that injects are written on */
+    struct Scheduler  *sched;
+    /* source of injects, signals or ticks written to this, if any */
+    struct ChanSource  *source;
     
     struct ChanEndQ  endQ;
     struct ChanEndQ  altQ;
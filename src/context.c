@@ -57,8 +57,9 @@ void ctx_init(Ctx *ctx, Proc *proc)
     _ctx_get(ctx);
     if (!proc) return;
 
-    // set stackpointer (sp) to top+1 of stack
-    volatile uintptr_t *sp = (uintptr_t *)((uintptr_t)proc->stack.ptr + proc->stack.size);
+    // set stackpointer (sp) to top+1 of stack, below reserved args
+    volatile uintptr_t *sp = (uintptr_t *)((uintptr_t)proc->stack.ptr + proc->stack.size
+                                           - proc->stack.reserved);
     // align stack
     sp = (uintptr_t *)((uintptr_t)sp & (uintptr_t)~0xf); 
 
@@ -147,9 +148,9 @@ void ctx_init(Ctx *ctx, Proc *proc)
     ASSERT_0(ret);
     if (!proc) return;
 
-    ctx->uc_link          = &proc->sched->ctx;
+    ctx->uc_link          = proc->sched->loop_ctx;
     ctx->uc_stack.ss_sp   = proc->stack.ptr;
-    ctx->uc_stack.ss_size = proc->stack.size; 
+    ctx->uc_stack.ss_size = proc->stack.size - proc->stack.reserved;
     makecontext(ctx, (void(*)(void))proc_mainfxn, 1, proc);
     ASSERT_0(ret);
 }
@@ -8,40 +8,124 @@
 
 #include "internal.h"
 
-void* csp_create(enum BuildType type) {
-    Builder *builder = NULL;
-    switch (type) {
-    case PROC_BUILD: {
-        ProcBuild *pb = malloc(sizeof(ProcBuild));
-        builder = BUILDER_CAST(pb, Builder*);
-        break;
-    } 
-    case PAR_BUILD: {
-        SeqBuild *sb = malloc(sizeof(ParBuild));
-        builder = BUILDER_CAST(sb, Builder*);
-        break;
+static inline
+void _csp_initheader(Builder *builder, enum BuildType type)
+{
+    builder->header.type = type;
+    builder->header.parent = NULL;
+    builder->header.is_root = 0;
+    builder->header.run_proc = NULL;
+    builder->header.is_inline = 0;
+    builder->header.arena = NULL;
+    builder->header.tmpl = NULL;
+    builder->header.future = NULL;
+    builder->header.deadline_us = 0;
+    builder->header.deadline.is_armed = 0;
+    builder->header.is_cancelled = 0;
+    builder->header.is_done = 0;
+}
+
+/*
+ * Builders are allocated from the current arena of the scheduler,
+ * so a build tree is usually packed in one arena. When the arena
+ * is full a new one is made current, and the old is freed when
+ * the last of its builders is freed. Large allocations get an
+ * arena of their own.
+ */
+static
+void* _csp_alloc(size_t size, Arena **owner)
+{
+    Scheduler *sched = scheduler_self();
+    Arena *arena;
+    void *ptr;
+
+    if (size > BUILD_ARENA_SIZE / 4) {
+        if (!(arena = arena_create(size))) {
+            return NULL;
+        }
+        *owner = arena;
+        return arena_alloc(arena, size);
     }
-    case SEQ_BUILD: {
-        ParBuild *pb = malloc(sizeof(SeqBuild)); 
-        builder = BUILDER_CAST(pb, Builder*);
-        break;
+
+    arena = sched->build_arena;
+    if (arena && (ptr = arena_alloc(arena, size))) {
+        *owner = arena;
+        return ptr;
     }
+
+    if (arena && arena->live == 0) {
+        /* full, but all builders freed, so reuse it */
+        arena_reset(arena);
+    }
+    else {
+        if (!(arena = arena_create(BUILD_ARENA_SIZE))) {
+            return NULL;
+        }
+        if (sched->build_arena) {
+            sched->build_arena->is_current = 0;
+        }
+        arena->is_current = 1;
+        sched->build_arena = arena;
+    }
+
+    *owner = arena;
+    return arena_alloc(arena, size);
+}
+
+void* csp_create(enum BuildType type) {
+    size_t size = 0;
+    switch (type) {
+    case PROC_BUILD: size = sizeof(ProcBuild); break;
+    case PAR_BUILD:  size = sizeof(ParBuild);  break;
+    case SEQ_BUILD:  size = sizeof(SeqBuild);  break;
     }
+
+    Arena *arena;
+    Builder *builder = _csp_alloc(size, &arena);
     if (!builder) return NULL;
 
-    builder->header.type = type;
-    builder->header.parent = NULL;
-    builder->header.is_root = 0;
-    builder->header.run_proc = NULL;
+    _csp_initheader(builder, type);
+    builder->header.arena = arena;
 
     return builder;
 }
 
+/*
+ * Allocates a ParBuild with room for num ProcBuild childs
+ * following it, which are freed together with the ParBuild.
+ */
+ParBuild* csp_createparn(size_t num)
+{
+    Arena *arena;
+    ParBuild *pb = _csp_alloc(sizeof(ParBuild) + sizeof(ProcBuild) * num, &arena);
+    if (!pb) return NULL;
+
+    Builder *builder = BUILDER_CAST(pb, Builder*);
+    _csp_initheader(builder, PAR_BUILD);
+    builder->header.arena = arena;
+
+    ProcBuild *childs = (ProcBuild *)(pb + 1);
+    for (size_t i = 0; i < num; ++i) {
+        _csp_initheader(BUILDER_CAST(&childs[i], Builder*), PROC_BUILD);
+    }
+
+    return pb;
+}
+
 void csp_free(Builder *build)
 {
     if (!build) return;
 
-    free(build);
+    Arena *arena = build->header.arena;
+    if (arena_release(arena) > 0) return;
+
+    /* current arena is kept for the next builders */
+    if (arena->is_current) {
+        arena_reset(arena);
+    }
+    else {
+        arena_free(arena);
+    }
 }
 
 int csp_insertchilds(size_t *num_childs, Builder *builder, struct BuilderQ *childQ, va_list vargs)
@@ -69,69 +153,248 @@ int csp_insertchilds(size_t *num_childs, Builder *builder, struct BuilderQ *chil
     return 0;
 }
 
+/*
+ * Returns the build after curr in a pre-order walk of root,
+ * or NULL when all builds are visited.
+ */
+static
+Builder* _csp_nextbuild(Builder *root, Builder *curr)
+{
+    Builder *child = NULL;
+    switch (curr->header.type) {
+    case PROC_BUILD:
+        break;
+    case PAR_BUILD:
+        child = TAILQ_FIRST(&BUILDER_CAST(curr, ParBuild*)->childQ);
+        break;
+    case SEQ_BUILD:
+        child = TAILQ_FIRST(&BUILDER_CAST(curr, SeqBuild*)->childQ);
+        break;
+    }
+    if (child) {
+        return child;
+    }
+
+    /* else next sibling of curr, or of the nearest parent */
+    while (curr != root) {
+        Builder *next = TAILQ_NEXT(curr, header.node);
+        if (next) {
+            return next;
+        }
+        curr = curr->header.parent;
+    }
+    return NULL;
+}
+
+/*
+ * Returns the build after curr in a walk of the started builds
+ * of root, which are all childs of a PAR, and only the current
+ * child of a SEQ. The childs of curr are skipped unless descend.
+ * The walk is iterative through parent pointers, so a deep tree
+ * does not use stack of the calling PROC.
+ */
+static
+Builder* _csp_nextstarted(Builder *root, Builder *curr, int descend)
+{
+    Builder *child = NULL;
+    if (descend) {
+        switch (curr->header.type) {
+        case PROC_BUILD:
+            break;
+        case PAR_BUILD:
+            child = TAILQ_FIRST(&BUILDER_CAST(curr, ParBuild*)->childQ);
+            break;
+        case SEQ_BUILD:
+            child = BUILDER_CAST(curr, SeqBuild*)->curr_build;
+            break;
+        }
+    }
+    if (child) {
+        return child;
+    }
+
+    /* else next sibling in a PAR, of curr or the nearest parent */
+    while (curr != root) {
+        Builder *parent = curr->header.parent;
+        Builder *next;
+        if (parent->header.type == PAR_BUILD
+            && (next = TAILQ_NEXT(curr, header.node))) {
+            return next;
+        }
+        curr = parent;
+    }
+    return NULL;
+}
+
+static
+void _csp_deadline(void *arg)
+{
+    PDEBUG("build deadline passed\n");
+    csp_cancelbuild(arg);
+}
+
 void csp_runbuild(Builder *build)
 {
-    switch (build->header.type) {
-    case PROC_BUILD: {
+    ASSERT_NOTNULL(build);
+
+    Builder *curr;
+    for (curr = build; curr; curr = _csp_nextstarted(build, curr, 1)) {
+        if (curr->header.deadline_us > 0) {
+            Timer *timer = &curr->header.deadline;
+            timer->usec = gettimestamp() + curr->header.deadline_us;
+            timer->fxn  = _csp_deadline;
+            timer->arg  = curr;
+            scheduler_addtimer(scheduler_self(), timer);
+        }
+        if (curr->header.type != PROC_BUILD) {
+            continue;
+        }
+
         PDEBUG("PROC_BUILD started\n");
-        ProcBuild *proc_build = BUILDER_CAST(build, ProcBuild*);
-        scheduler_addready(proc_build->proc);
-        break;
+        /* run by the RUN caller itself */
+        if (curr->header.is_inline) {
+            continue;
+        }
+        Proc *proc = BUILDER_CAST(curr, ProcBuild*)->proc;
+        /* bulk PROCs are prepared by the scheduler, when resumed */
+        if (!proc->is_bulk) {
+            int ret = proc_prepare(proc);
+            ASSERT_0(ret);
+        }
+        scheduler_addready(proc);
+    }
+}
+
+/*
+ * Cancels all started and not done builds of build, and their
+ * PROCs. Blocked PROCs are woken, and childs of a SEQ not yet
+ * started are skipped. The builds are done, and freed, as usual
+ * when their PROCs return.
+ */
+void csp_cancelbuild(Builder *build)
+{
+    ASSERT_NOTNULL(build);
+
+    Builder *curr = build;
+    while (curr) {
+        int descend = !curr->header.is_done && !curr->header.is_cancelled;
+        if (descend) {
+            curr->header.is_cancelled = 1;
+            if (curr->header.type == PROC_BUILD && !curr->header.is_inline) {
+                proc_cancel(BUILDER_CAST(curr, ProcBuild*)->proc);
+            }
+        }
+        curr = _csp_nextstarted(build, curr, descend);
     }
-    case PAR_BUILD: {
-        PDEBUG("PAR_BUILD started\n");
+}
+
+/*
+ * Finds the PROC which the RUN caller can run on its own stack,
+ * which is the root if a PROC, or else the last child of a PAR,
+ * and so on through nested PARs. SEQ childs are not run inline,
+ * as the caller would then have to run every child of the SEQ.
+ */
+ProcBuild* csp_inlinebuild(Builder *root)
+{
+    ASSERT_NOTNULL(root);
+
+    /* a deadline cancels the PROCs of its build, but not */
+    /* the RUN caller, so those are not run inline */
+    Builder *build = root;
+    while (build->header.type == PAR_BUILD) {
+        if (build->header.deadline_us > 0) {
+            return NULL;
+        }
         ParBuild *par_build = BUILDER_CAST(build, ParBuild*);
-        Builder *child;
-        TAILQ_FOREACH(child, &par_build->childQ, header.node) {
-            csp_runbuild(child);
+        build = TAILQ_LAST(&par_build->childQ, BuilderQ);
+        if (!build) {
+            return NULL;
         }
-        break;
     }
-    case SEQ_BUILD: {
-        PDEBUG("SEQ_BUILD started\n");
-        SeqBuild *seq_build = BUILDER_CAST(build, SeqBuild*);
-        csp_runbuild(seq_build->curr_build);
-        break;
+    if (build->header.type != PROC_BUILD || build->header.deadline_us > 0) {
+        return NULL;
     }
+
+    ProcBuild *proc_build = BUILDER_CAST(build, ProcBuild*);
+    /* stack already set up, as for args on top of stack */
+    if (proc_build->proc->stack.ptr) {
+        return NULL;
     }
+
+    build->header.is_inline = 1;
+    return proc_build;
 }
 
 void csp_cleanupbuild(Builder *build)
 {
     ASSERT_NOTNULL(build);
 
-    Builder *child;
-    switch (build->header.type) {
-    case PROC_BUILD:
-        PDEBUG("proc_build cleanup\n");
-        /* proc_build has no childs, and the scheduler frees */
-        /* the actual PROC struct, so only free the proc_build */
-        break;
-    case PAR_BUILD: {
-        PDEBUG("par_build cleanup\n");
-        /* recursively free all childs */
-        ParBuild *par_build = BUILDER_CAST(build, ParBuild*);
-        while (!TAILQ_EMPTY(&par_build->childQ)) {
-            child = TAILQ_FIRST(&par_build->childQ);
-            TAILQ_REMOVE(&par_build->childQ, child, header.node);
-            csp_cleanupbuild(child);
+    Builder *curr = build;
+    while (curr) {
+        struct BuilderQ *childQ = NULL;
+        switch (curr->header.type) {
+        case PROC_BUILD:
+            /* proc_build has no childs, and the scheduler frees */
+            /* the actual PROC struct, so only free the proc_build */
+            break;
+        case PAR_BUILD: {
+            ParBuild *par_build = BUILDER_CAST(curr, ParBuild*);
+            /* replicated PAR, childs are freed along with itself */
+            if (par_build->bulk_procs) {
+                proc_freebulk(par_build->bulk_procs);
+                break;
+            }
+            childQ = &par_build->childQ;
+            break;
         }
-        break;
-    }
-    case SEQ_BUILD: {
-        PDEBUG("seq_build cleanup\n");
-        SeqBuild *seq_build = BUILDER_CAST(build, SeqBuild*);
-        while (!TAILQ_EMPTY(&seq_build->childQ)) {
-            child = TAILQ_FIRST(&seq_build->childQ);
-            TAILQ_REMOVE(&seq_build->childQ, child, header.node);
-            csp_cleanupbuild(child);
+        case SEQ_BUILD: {
+            SeqBuild *seq_build = BUILDER_CAST(curr, SeqBuild*);
+            childQ = &seq_build->childQ;
+            break;
         }
-        break;
-    }
+        }
+
+        /* descend into the first child not yet freed */
+        if (childQ && !TAILQ_EMPTY(childQ)) {
+            Builder *child = TAILQ_FIRST(childQ);
+            TAILQ_REMOVE(childQ, child, header.node);
+            curr = child;
+            continue;
+        }
+
+        /* when childs are freed, free itself and go back up */
+        PDEBUG("build cleanup\n");
+        Builder *parent = (curr != build) 
+                        ? curr->header.parent
+                        : NULL;
+        csp_free(curr);
+        curr = parent;
     }
+}
 
-    /* when childs are freed, free itself */
-    csp_free(build);
+/*
+ * Drops the childs of a SEQ after the current, which are never
+ * started. Their PROCs are freed here, as they never end.
+ */
+static
+void _csp_dropchilds(SeqBuild *seq_build)
+{
+    Builder *child = TAILQ_NEXT(seq_build->curr_build, header.node);
+    for (; child; child = TAILQ_NEXT(child, header.node)) {
+        Builder *build;
+        for (build = child; build; build = _csp_nextbuild(child, build)) {
+            if (build->header.type != PROC_BUILD) {
+                continue;
+            }
+            Proc *proc = BUILDER_CAST(build, ProcBuild*)->proc;
+            TAILQ_REMOVE(&proc->sched->totalQ, proc, schedQ_node);
+            /* bulk PROCs are freed along with their builder, */
+            /* and template PROCs with the template */
+            if (!proc->is_bulk && !proc->is_tmpl) {
+                proc_release(proc);
+            }
+        }
+    }
 }
 
 void csp_parsebuild(Builder *build)
@@ -139,58 +402,205 @@ void csp_parsebuild(Builder *build)
     ASSERT_NOTNULL(build);
     /* FIXME atomic */
 
-    int build_done = 0;
-    switch (build->header.type) {
-    case PROC_BUILD: {
-        /* a finished proc_build always causes cleanup */
-        PDEBUG("proc_build finished\n");
-        build_done = 1;
-        break;
-    }
-    case PAR_BUILD: {
-        ParBuild *par_build = BUILDER_CAST(build, ParBuild*);
-        /* if par_build has no more active childs, do cleanup */
-        if (--par_build->num_childs == 0) {
-            PDEBUG("par_build finished\n");
+    while (build) {
+        int build_done = 0;
+        switch (build->header.type) {
+        case PROC_BUILD: {
+            /* a finished proc_build always causes cleanup */
+            PDEBUG("proc_build finished\n");
             build_done = 1;
             break;
         }
-        /* if num_childs != 0 means still running childs */
-        break;
-    }
-    case SEQ_BUILD: {
-        SeqBuild *seq_build = BUILDER_CAST(build, SeqBuild*);
-        if (--seq_build->num_childs == 0) {
-            PDEBUG("seq_build finished\n");
-            build_done = 1;
+        case PAR_BUILD: {
+            ParBuild *par_build = BUILDER_CAST(build, ParBuild*);
+            /* if par_build has no more active childs, do cleanup */
+            if (--par_build->num_childs == 0) {
+                PDEBUG("par_build finished\n");
+                build_done = 1;
+                break;
+            }
+            /* if num_childs != 0 means still running childs */
             break;
         }
+        case SEQ_BUILD: {
+            SeqBuild *seq_build = BUILDER_CAST(build, SeqBuild*);
+            if (--seq_build->num_childs == 0) {
+                PDEBUG("seq_build finished\n");
+                build_done = 1;
+                break;
+            }
 
-        /* run next build in SEQ list */
-        Builder *cbuild= TAILQ_NEXT(seq_build->curr_build, header.node);
-        ASSERT_NOTNULL(cbuild);
-        csp_runbuild(cbuild);
-        seq_build->curr_build = cbuild;
-        break;
-    }
-    }
+            /* a cancelled SEQ skips the childs not yet run */
+            if (build->header.is_cancelled) {
+                _csp_dropchilds(seq_build);
+                PDEBUG("seq_build cancelled\n");
+                build_done = 1;
+                break;
+            }
+
+            /* run next build in SEQ list */
+            Builder *cbuild= TAILQ_NEXT(seq_build->curr_build, header.node);
+            ASSERT_NOTNULL(cbuild);
+            csp_runbuild(cbuild);
+            seq_build->curr_build = cbuild;
+            break;
+        }
+        }
+
+        if (!build_done) {
+            return;
+        }
+        build->header.is_done = 1;
+        scheduler_remtimer(scheduler_self(), &build->header.deadline);
 
-    if (build_done) {
         /* if root, then cleanup entire tree */
         if (build->header.is_root) {
             /* if run_proc defined, then root of build  */
             /* is in a RUN, else in GO, then no need */
             /* to reschedule anything */
+            int status = (build->header.is_cancelled) ? PROXC_ECANCEL : 0;
             Proc *run_proc = build->header.run_proc;
             if (run_proc != NULL) {
+                run_proc->run_build  = NULL;
+                run_proc->run_status = status;
                 scheduler_addready(run_proc);
             }
+            if (build->header.future) {
+                future_complete(build->header.future, (status) ? status : 1);
+            }
+            /* a template is kept for the next run */
+            Template *tmpl = build->header.tmpl;
+            if (tmpl) {
+                tmpl->is_running = 0;
+                return;
+            }
             csp_cleanupbuild(build);
+            return;
+        }
+
+        /* or resolve the underlying parent */
+        build = build->header.parent;
+    }
+}
+
+/*
+ * Returns the FUTURE resolved by the tree of build, if any. The
+ * root of a RUN is left for the tree of the PROC which ran it, up
+ * to the nearest root with a FUTURE, or that of a GO without one.
+ */
+Future* csp_future(Builder *build)
+{
+    while (build) {
+        if (!build->header.is_root) {
+            build = build->header.parent;
+            continue;
+        }
+        if (build->header.future || !build->header.run_proc) {
+            return build->header.future;
+        }
+        build = BUILDER_CAST(build->header.run_proc->proc_build, Builder*);
+    }
+    return NULL;
+}
+
+/*
+ * Takes ownership of the tree of root, which is not yet run. Its
+ * PROCs are unregistered from the scheduler until a run, and
+ * are kept with the builders when done instead of being freed.
+ */
+Template* csp_tmplcreate(Builder *root)
+{
+    ASSERT_NOTNULL(root);
+
+    Template *tmpl;
+    if (!(tmpl = malloc(sizeof(Template)))) {
+        PERROR("malloc failed for Template\n");
+        return NULL;
+    }
+
+    tmpl->root = root;
+    tmpl->arg  = NULL;
+    tmpl->is_running = 0;
+
+    root->header.is_root = 1;
+    root->header.tmpl = tmpl;
+
+    Builder *build;
+    for (build = root; build; build = _csp_nextbuild(root, build)) {
+        if (build->header.type != PROC_BUILD) {
+            continue;
         }
-        /* or schedule the underlying parent */
-        else  {
+        Proc *proc = BUILDER_CAST(build, ProcBuild*)->proc;
+        TAILQ_REMOVE(&proc->sched->totalQ, proc, schedQ_node);
+        proc->is_tmpl   = 1;
+        proc->args.tmpl = tmpl;
+    }
+
+    return tmpl;
+}
+
+void csp_tmplfree(Template *tmpl)
+{
+    if (!tmpl) return;
+
+    ASSERT_TRUE(!tmpl->is_running);
+
+    Builder *root = tmpl->root;
+    Builder *build;
+    for (build = root; build; build = _csp_nextbuild(root, build)) {
+        if (build->header.type != PROC_BUILD) {
+            continue;
+        }
+        /* bulk PROCs are freed along with their builder */
+        Proc *proc = BUILDER_CAST(build, ProcBuild*)->proc;
+        if (!proc->is_bulk) {
+            proc_release(proc);
+        }
+    }
+
+    csp_cleanupbuild(root);
+    free(tmpl);
+}
+
+/*
+ * Restores the counters of all builders, and readies all
+ * PROCs, so the tree can be run again with no allocations.
+ */
+void csp_tmplreset(Template *tmpl)
+{
+    ASSERT_NOTNULL(tmpl);
+
+    Builder *root = tmpl->root;
+    Builder *build;
+    for (build = root; build; build = _csp_nextbuild(root, build)) {
+        /* count self in parent, which is visited before */
+        if (build != root) {
             Builder *parent = build->header.parent;
-            csp_parsebuild(parent);
+            if (parent->header.type == PAR_BUILD) {
+                BUILDER_CAST(parent, ParBuild*)->num_childs++;
+            }
+            else {
+                BUILDER_CAST(parent, SeqBuild*)->num_childs++;
+            }
+        }
+
+        build->header.is_cancelled = 0;
+        build->header.is_done = 0;
+
+        switch (build->header.type) {
+        case PROC_BUILD:
+            build->header.is_inline = 0;
+            proc_reset(BUILDER_CAST(build, ProcBuild*)->proc);
+            break;
+        case PAR_BUILD:
+            BUILDER_CAST(build, ParBuild*)->num_childs = 0;
+            break;
+        case SEQ_BUILD: {
+            SeqBuild *seq_build = BUILDER_CAST(build, SeqBuild*);
+            seq_build->num_childs = 0;
+            seq_build->curr_build = TAILQ_FIRST(&seq_build->childQ);
+            break;
+        }
         }
     }
 }
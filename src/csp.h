@@ -16,6 +16,25 @@ struct Header {
     int   is_root;
     Proc  *run_proc;
 
+    /* PROC run directly by the RUN caller, not scheduled */
+    int   is_inline;
+
+    /* arena this builder is allocated from */
+    struct Arena  *arena;
+
+    /* set in the root of a template, which is kept when done */
+    struct Template  *tmpl;
+
+    /* set in the root of a GO, resolved when done */
+    struct Future  *future;
+
+    /* relative deadline, armed when the build is started */
+    uint64_t      deadline_us;
+    struct Timer  deadline;
+
+    int  is_cancelled;
+    int  is_done;
+
     TAILQ_ENTRY(Builder)  node;
 };
 
@@ -34,6 +53,11 @@ struct ParBuild {
 
     size_t           num_childs;
     struct BuilderQ  childQ;
+
+    /* set for a replicated PAR, where the childs are */
+    /* allocated together with this, and the PROCs */
+    /* in bulk, with stacks taken as they are run */
+    Proc  *bulk_procs;
 };
 
 struct SeqBuild {
@@ -44,5 +68,13 @@ struct SeqBuild {
     struct BuilderQ  childQ;
 };
 
+struct Template {
+    Builder  *root;
+
+    /* arg of the current run, and if a run is in progress */
+    void  *arg;
+    int   is_running;
+};
+
 #endif /* PAR_H__ */
 
@@ -0,0 +1,188 @@
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+
+#include "internal.h"
+
+Future* future_create(size_t size)
+{
+    Future *fut;
+
+    /* alloc FUTURE struct, with zeroed result */
+    if (!(fut = calloc(1, sizeof(Future) + size))) {
+        PERROR("calloc failed for Future\n");
+        return NULL;
+    }
+
+    PDEBUG("FUTURE of size %zu created\n", size);
+
+    /* set FUTURE members */
+    fut->size    = size;
+    fut->is_done = 0;
+    fut->status  = 0;
+    fut->root    = NULL;
+    TAILQ_INIT(&fut->waitQ);
+    TAILQ_INIT(&fut->altQ);
+
+    return fut;
+}
+
+/*
+ * A FUTURE may be freed before it is done, which detaches it
+ * from its tree, and the result is then discarded.
+ */
+void future_free(Future *fut)
+{
+    if (!fut) return;
+
+    ASSERT_TRUE(TAILQ_EMPTY(&fut->waitQ));
+
+    if (fut->root) {
+        fut->root->header.future = NULL;
+    }
+
+    PDEBUG("FUTURE freed\n");
+    free(fut);
+}
+
+void future_setresult(Future *fut, const void *data, size_t size)
+{
+    ASSERT_NOTNULL(fut);
+    ASSERT_EQ(fut->size, size);
+
+    copydata(fut->result, data, fut->size);
+}
+
+/*
+ * Called when the tree of the FUTURE is done. Accepts all
+ * alting PROCs, and releases all awaiting PROCs in one batch.
+ */
+void future_complete(Future *fut, int status)
+{
+    ASSERT_NOTNULL(fut);
+
+    // << acquire lock <<
+
+    fut->is_done = 1;
+    fut->status  = status;
+    fut->root    = NULL;
+
+    PDEBUG("FUTURE done, releasing PROCs\n");
+
+    Guard *guard;
+    while ((guard = TAILQ_FIRST(&fut->altQ))) {
+        TAILQ_REMOVE(&fut->altQ, guard, fut_node);
+        guard->in_fut = 2;
+        if (alt_accept(guard)) {
+            Proc *alt_proc = guard->alt->proc;
+            if (alt_proc->state == PROC_ALTWAIT) {
+                scheduler_addready(alt_proc);
+            }
+        }
+    }
+
+    Proc *proc = TAILQ_FIRST(&fut->waitQ);
+    if (proc) {
+        Scheduler *sched = proc->sched;
+        TAILQ_FOREACH(proc, &fut->waitQ, readyQ_next) {
+            proc->state = PROC_READY;
+        }
+        TAILQ_CONCAT(&sched->readyQ, &fut->waitQ, readyQ_next);
+    }
+
+    // >> release lock >>
+}
+
+int future_await(Future *fut, void *out, size_t size)
+{
+    ASSERT_NOTNULL(fut);
+    ASSERT_EQ(fut->size, size);
+
+    // << acquire lock <<
+
+    if (!fut->is_done) {
+        Proc *proc = proc_self();
+        if (UNLIKELY(proc_cancelpoint(proc))) {
+            // >> release lock >>
+            return PROXC_ECANCEL;
+        }
+        TAILQ_INSERT_TAIL(&fut->waitQ, proc, readyQ_next);
+
+        // >> release lock >>
+
+        PDEBUG("FUTURE await, not done, park\n");
+
+        /* yield until the tree of the FUTURE is done */
+        proc->wait_obj    = fut;
+        proc->wait_status = 1;
+        proc->state = PROC_FUTWAIT;
+        proc_yield(proc);
+        proc->wait_obj = NULL;
+        if (UNLIKELY(proc->wait_status < 0)) {
+            return proc->wait_status;
+        }
+    }
+    else {
+        // >> release lock >>
+    }
+
+    if (out) {
+        copydata(out, fut->result, fut->size);
+    }
+    return fut->status;
+}
+
+int future_altenable(Future *fut, Guard *guard)
+{
+    ASSERT_NOTNULL(fut);
+    ASSERT_NOTNULL(guard);
+
+    if (fut->is_done) {
+        return 1;
+    }
+
+    TAILQ_INSERT_TAIL(&fut->altQ, guard, fut_node);
+    guard->in_fut = 1;
+
+    return 0;
+}
+
+void future_altdisable(Future *fut, Guard *guard)
+{
+    ASSERT_NOTNULL(fut);
+    ASSERT_NOTNULL(guard);
+    ASSERT_EQ(fut, guard->fut);
+
+    TAILQ_REMOVE(&fut->altQ, guard, fut_node);
+    guard->in_fut = 0;
+}
+
+void future_altread(Future *fut, Guard *guard, size_t size)
+{
+    ASSERT_NOTNULL(fut);
+    ASSERT_NOTNULL(guard);
+    ASSERT_EQ(fut->size, size);
+    ASSERT_TRUE(fut->is_done);
+
+    if (guard->data.ptr) {
+        copydata(guard->data.ptr, fut->result, fut->size);
+    }
+}
+
+/*
+ * Called when a PROC awaiting fut is cancelled.
+ */
+void future_cancel(Future *fut, Proc *proc)
+{
+    ASSERT_NOTNULL(fut);
+    ASSERT_NOTNULL(proc);
+
+    // << acquire lock <<
+    TAILQ_REMOVE(&fut->waitQ, proc, readyQ_next);
+    // >> release lock >>
+
+    PDEBUG("FUTURE await cancelled\n");
+    proc->wait_status = PROXC_ECANCEL;
+    scheduler_addready(proc);
+}
@@ -0,0 +1,28 @@
+
+#ifndef FUTURE_H__
+#define FUTURE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "internal.h"
+
+struct Future {
+    size_t  size;
+    int     is_done;
+    /* 1 when done, or PROXC_ECANCEL if the tree was cancelled */
+    int     status;
+
+    /* root of the tree which resolves this, until done */
+    struct Builder  *root;
+
+    /* awaiting PROCs, linked through readyQ_next */
+    struct ProcQ   waitQ;
+    /* alting PROCs */
+    struct GuardQ  altQ;
+
+    /* result slot, of size bytes */
+    unsigned char  result[] __attribute__((aligned(16)));
+};
+
+#endif /* FUTURE_H__ */
@@ -0,0 +1,208 @@
+
+/*
+ * Interposes blocking libc calls, so code which is not written
+ * for proxc parks its PROC instead of the scheduler thread when
+ * run in one. Built as libproxc_hook with the PROXC_HOOK cmake
+ * option, and loaded with LD_PRELOAD into programs linked with
+ * the shared libproxc. Outside a PROC, and on fds put in
+ * non-blocking mode by the caller, calls go to libc unchanged.
+ *
+ * The flags of fds are left as set by the caller: sockets are
+ * read and written with MSG_DONTWAIT, and other fds are waited on
+ * until ready, so a large write to a pipe may still block.
+ */
+
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <dlfcn.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+
+#include "../internal.h"
+
+static struct {
+    ssize_t  (*read)(int, void *, size_t);
+    ssize_t  (*write)(int, const void *, size_t);
+    int      (*connect)(int, const struct sockaddr *, socklen_t);
+    int      (*close)(int);
+    int      (*poll)(struct pollfd *, nfds_t, int);
+    unsigned (*sleep)(unsigned);
+    int      (*usleep)(useconds_t);
+} g_real;
+
+__attribute__((constructor))
+static
+void _hook_init(void)
+{
+    g_real.read    = dlsym(RTLD_NEXT, "read");
+    g_real.write   = dlsym(RTLD_NEXT, "write");
+    g_real.connect = dlsym(RTLD_NEXT, "connect");
+    g_real.close   = dlsym(RTLD_NEXT, "close");
+    g_real.poll    = dlsym(RTLD_NEXT, "poll");
+    g_real.sleep   = dlsym(RTLD_NEXT, "sleep");
+    g_real.usleep  = dlsym(RTLD_NEXT, "usleep");
+    if (!g_real.read || !g_real.write || !g_real.connect || !g_real.close
+        || !g_real.poll || !g_real.sleep || !g_real.usleep) {
+        PANIC("dlsym failed for hooked calls\n");
+    }
+}
+
+/* libc may be called before the constructor, by other constructors */
+#define HOOK_REAL(fxn) \
+    (UNLIKELY(!g_real.fxn) ? (_hook_init(), g_real.fxn) : g_real.fxn)
+
+static inline
+int _hook_inproc(void)
+{
+    Scheduler *sched = scheduler_current();
+    return sched && sched->curr_proc;
+}
+
+/* whether the caller expects fd to block, else it is left alone */
+static inline
+int _hook_isblocking(int fd)
+{
+    int flags = fcntl(fd, F_GETFL);
+    return flags != -1 && !(flags & O_NONBLOCK);
+}
+
+static inline
+int _hook_again(void)
+{
+    return errno == EAGAIN || errno == EWOULDBLOCK;
+}
+
+/* parks until fd is ready, else returns -1 with errno set */
+static inline
+int _hook_park(int fd, short events)
+{
+    struct pollfd pfd = { .fd = fd, .events = events, .revents = 0 };
+    return (io_pollfds(&pfd, 1, -1) < 0) ? -1 : 0;
+}
+
+ssize_t read(int fd, void *buf, size_t count)
+{
+    if (!_hook_inproc() || !_hook_isblocking(fd)) {
+        return HOOK_REAL(read)(fd, buf, count);
+    }
+    MONITOR_GATE_ERRNO();
+
+    for (;;) {
+        ssize_t ret = recv(fd, buf, count, MSG_DONTWAIT);
+        if (ret >= 0) {
+            return ret;
+        }
+        if (errno == ENOTSOCK) {
+            break;
+        }
+        if (!_hook_again() || _hook_park(fd, POLLIN)) {
+            return -1;
+        }
+    }
+
+    if (_hook_park(fd, POLLIN)) {
+        return -1;
+    }
+    return HOOK_REAL(read)(fd, buf, count);
+}
+
+ssize_t write(int fd, const void *buf, size_t count)
+{
+    if (!_hook_inproc() || !_hook_isblocking(fd)) {
+        return HOOK_REAL(write)(fd, buf, count);
+    }
+    MONITOR_GATE_ERRNO();
+
+    /* a blocking write to a socket returns once all is sent */
+    size_t done = 0;
+    for (;;) {
+        ssize_t ret = send(fd, (const char *)buf + done, count - done, MSG_DONTWAIT);
+        if (ret >= 0) {
+            done += (size_t)ret;
+            if (done == count) {
+                return (ssize_t)done;
+            }
+            continue;
+        }
+        if (errno == ENOTSOCK) {
+            break;
+        }
+        if (!_hook_again() || _hook_park(fd, POLLOUT)) {
+            return (done > 0) ? (ssize_t)done : -1;
+        }
+    }
+
+    if (_hook_park(fd, POLLOUT)) {
+        return -1;
+    }
+    return HOOK_REAL(write)(fd, buf, count);
+}
+
+/* the socket is non-blocking only for the connect, then restored */
+int connect(int fd, const struct sockaddr *addr, socklen_t addrlen)
+{
+    int flags;
+    if (!_hook_inproc() || (flags = fcntl(fd, F_GETFL)) == -1
+        || (flags & O_NONBLOCK) || fcntl(fd, F_SETFL, flags | O_NONBLOCK) == -1) {
+        return HOOK_REAL(connect)(fd, addr, addrlen);
+    }
+    MONITOR_GATE_ERRNO();
+
+    int ret = HOOK_REAL(connect)(fd, addr, addrlen);
+    if (ret == -1 && errno == EINPROGRESS) {
+        if ((ret = _hook_park(fd, POLLOUT)) == 0) {
+            int err = 0;
+            socklen_t len = sizeof(err);
+            if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) == -1) {
+                ret = -1;
+            }
+            else if (err) {
+                errno = err;
+                ret = -1;
+            }
+        }
+    }
+
+    int saved = errno;
+    fcntl(fd, F_SETFL, flags);
+    errno = saved;
+    return ret;
+}
+
+/* drops what proxc_read and the like cached for fd, as it is reused */
+int close(int fd)
+{
+    io_forget(fd);
+    return HOOK_REAL(close)(fd);
+}
+
+int poll(struct pollfd *fds, nfds_t nfds, int timeout)
+{
+    if (timeout == 0 || !_hook_inproc()) {
+        return HOOK_REAL(poll)(fds, nfds, timeout);
+    }
+    MONITOR_GATE_ERRNO();
+    return io_pollfds(fds, nfds, timeout);
+}
+
+unsigned sleep(unsigned seconds)
+{
+    if (!_hook_inproc()) {
+        return HOOK_REAL(sleep)(seconds);
+    }
+    MONITOR_GATE();
+    proc_sleep(proc_self(), 1000000ULL * seconds);
+    return 0;
+}
+
+int usleep(useconds_t usec)
+{
+    if (!_hook_inproc()) {
+        return HOOK_REAL(usleep)(usec);
+    }
+    MONITOR_GATE();
+    proc_sleep(proc_self(), usec);
+    return 0;
+}
@@ -0,0 +1,273 @@
+
+#include <stdlib.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include "internal.h"
+
+/*
+ * Scheduler which posts from threads without one go to, the first
+ * to run that is not yet freed.
+ */
+static struct {
+    pthread_mutex_t  lock;
+    Scheduler        *sched;
+} g_inject = {
+    .lock  = PTHREAD_MUTEX_INITIALIZER,
+    .sched = NULL
+};
+
+/*
+ * Pushes item to the inject LIFO of sched, and the first push
+ * after a drain wakes the scheduler. The caller holds a wake ref.
+ */
+static
+void _inject_push(Scheduler *sched, Inject *item)
+{
+    Inject *head = __atomic_load_n(&sched->injectQ, __ATOMIC_RELAXED);
+    do {
+        item->next = head;
+    } while (!__atomic_compare_exchange_n(&sched->injectQ, &head, item, 1,
+                                          __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+    if (!head) {
+        scheduler_notify(sched);
+    }
+
+    __atomic_sub_fetch(&sched->wake_refs, 1, __ATOMIC_RELEASE);
+}
+
+/* frees the items of ic not yet written */
+static
+void _inject_clear(InjectChan *ic)
+{
+    Inject *item, *next;
+    for (item = ic->head; item; item = next) {
+        next = item->next;
+        free(item);
+    }
+    ic->head = ic->tail = NULL;
+
+    free(ic->item);
+    ic->item = NULL;
+}
+
+/* yields the queued items in order, until none is left */
+static
+void* _inject_read(ChanSource *src)
+{
+    InjectChan *ic = (InjectChan *)src;
+
+    free(ic->item);
+    /* taken off first, as chan may be freed while writing */
+    if ((ic->item = ic->head)) {
+        ic->head = ic->item->next;
+        if (!ic->head) {
+            ic->tail = NULL;
+        }
+        return ic->item->data;
+    }
+    return NULL;
+}
+
+/* a poisoned chan is never read again */
+static
+void _inject_idle(ChanSource *src)
+{
+    InjectChan *ic = (InjectChan *)src;
+
+    if (src->chan->is_poisoned) {
+        _inject_clear(ic);
+    }
+}
+
+static
+void _inject_free(ChanSource *src)
+{
+    _inject_clear((InjectChan *)src);
+    free(src);
+}
+
+/* queues item to its chan, and starts the relay if none runs */
+static
+void _inject_tochan(Inject *item)
+{
+    Chan *chan = item->chan;
+    if (chan->is_poisoned) {
+        free(item);
+        return;
+    }
+
+    /* signals and ticks are not mixed with injects */
+    if (chan->source && chan->source->next != _inject_read) {
+        PERROR("Inject dropped, chan has a source of its own\n");
+        free(item);
+        return;
+    }
+
+    InjectChan *ic = (InjectChan *)chan->source;
+    if (!ic) {
+        if (!(ic = malloc(sizeof(InjectChan)))) {
+            PERROR("malloc failed for InjectChan\n");
+            free(item);
+            return;
+        }
+        ic->head = NULL;
+        ic->tail = NULL;
+        ic->item = NULL;
+        source_init(&ic->src, chan, _inject_read, _inject_idle, _inject_free);
+    }
+
+    item->next = NULL;
+    if (ic->tail) {
+        ic->tail->next = item;
+    }
+    else {
+        ic->head = item;
+    }
+    ic->tail = item;
+
+    /* else the items wait for the next inject to start one */
+    source_start(&ic->src);
+}
+
+/* called as sched starts running, with its wake set up */
+void inject_register(Scheduler *sched)
+{
+    ASSERT_NOTNULL(sched);
+
+    pthread_mutex_lock(&g_inject.lock);
+    if (!g_inject.sched) {
+        g_inject.sched = sched;
+    }
+    pthread_mutex_unlock(&g_inject.lock);
+}
+
+/* called as sched is freed, before it waits on its wake refs */
+void inject_unregister(Scheduler *sched)
+{
+    ASSERT_NOTNULL(sched);
+
+    pthread_mutex_lock(&g_inject.lock);
+    if (g_inject.sched == sched) {
+        g_inject.sched = NULL;
+    }
+    pthread_mutex_unlock(&g_inject.lock);
+}
+
+/*
+ * Spawns a PROC of fxn, with arg as ARGN(0), on the scheduler of
+ * the calling thread if it has one, and else on the first running.
+ * Safe to call from any thread.
+ */
+int inject_post(ProcFxn fxn, void *arg)
+{
+    ASSERT_NOTNULL(fxn);
+
+    pthread_mutex_lock(&g_inject.lock);
+    Scheduler *sched = scheduler_current();
+    if (!sched) {
+        sched = g_inject.sched;
+    }
+    if (sched && __atomic_load_n(&sched->wake.fd, __ATOMIC_RELAXED) == -1) {
+        sched = NULL;
+    }
+    if (sched) {
+        __atomic_add_fetch(&sched->wake_refs, 1, __ATOMIC_ACQ_REL);
+    }
+    pthread_mutex_unlock(&g_inject.lock);
+    if (!sched) {
+        return ESRCH;
+    }
+
+    Inject *item;
+    if (!(item = malloc(sizeof(Inject)))) {
+        PERROR("malloc failed for Inject\n");
+        __atomic_sub_fetch(&sched->wake_refs, 1, __ATOMIC_RELEASE);
+        return ENOMEM;
+    }
+    item->fxn  = fxn;
+    item->arg  = arg;
+    item->chan = NULL;
+
+    _inject_push(sched, item);
+    return 0;
+}
+
+/*
+ * Writes a copy of data to chan from any thread, queued in chan
+ * on the scheduler which opened it, and written in order of the
+ * calls by the relay PROC of chan. The chan and its scheduler must
+ * outlive the write.
+ */
+int inject_chan(Chan *chan, const void *data)
+{
+    ASSERT_NOTNULL(chan);
+
+    /* chan must be opened on a scheduler which can be woken */
+    Scheduler *sched = chan->sched;
+    if (!sched || __atomic_load_n(&sched->wake.fd, __ATOMIC_RELAXED) == -1) {
+        return EINVAL;
+    }
+
+    Inject *item;
+    if (!(item = malloc(sizeof(Inject) + chan->data_size))) {
+        PERROR("malloc failed for Inject\n");
+        return ENOMEM;
+    }
+    item->fxn  = NULL;
+    item->arg  = NULL;
+    item->chan = chan;
+    copydata(item->data, data, chan->data_size);
+
+    __atomic_add_fetch(&sched->wake_refs, 1, __ATOMIC_ACQ_REL);
+    _inject_push(sched, item);
+    return 0;
+}
+
+/*
+ * Called by the scheduler, queues the data of all items pushed
+ * since the last drain to their chans, and spawns the PROCs of
+ * the posts, in the order they were pushed.
+ */
+void inject_drain(Scheduler *sched)
+{
+    Inject *item = __atomic_exchange_n(&sched->injectQ, NULL, __ATOMIC_ACQUIRE);
+
+    Inject *prev = NULL, *next;
+    for (; item; item = next) {
+        next = item->next;
+        item->next = prev;
+        prev = item;
+    }
+    for (item = prev; item; item = next) {
+        next = item->next;
+
+        if (item->chan) {
+            _inject_tochan(item);
+            continue;
+        }
+        Proc *proc;
+        if (!proc_create(&proc, item->fxn)) {
+            proc_setarg(proc, item->arg);
+            if (!proc_prepare(proc)) {
+                free(item);
+                scheduler_addready(proc);
+                continue;
+            }
+            proc_free(proc);
+        }
+        PERROR("Inject dropped, failed to create PROC\n");
+        free(item);
+    }
+}
+
+/* frees items left as sched is freed, which are not run */
+void inject_free(Scheduler *sched)
+{
+    Inject *item = __atomic_exchange_n(&sched->injectQ, NULL, __ATOMIC_ACQUIRE);
+    Inject *next;
+    for (; item; item = next) {
+        next = item->next;
+        free(item);
+    }
+}
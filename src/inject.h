@@ -0,0 +1,40 @@
+
+#ifndef INJECT_H__
+#define INJECT_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "internal.h"
+
+/*
+ * Work handed to a scheduler by any thread, a PROC to spawn, or
+ * data to write to a chan.
+ */
+struct Inject {
+    ProcFxn  fxn;
+    void     *arg;
+
+    struct Chan  *chan;
+
+    /* in the inject LIFO of the scheduler, then the FIFO of chan */
+    struct Inject  *next;
+
+    /* data of chan size, if to a chan */
+    unsigned char  data[] __attribute__((aligned(16)));
+};
+
+/*
+ * Data injected to a chan and not yet read, in order, which the
+ * relay of the source writes while any is left.
+ */
+struct InjectChan {
+    ChanSource  src;
+
+    struct Inject  *head;
+    struct Inject  *tail;
+    /* item taken off, while the relay writes it */
+    struct Inject  *item;
+};
+
+#endif /* INJECT_H__ */
@@ -3,6 +3,11 @@
 #define INTERNAL_H__
 
 #include <stdarg.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
 
 #include "util/debug.h"
 #include "util/util.h"
@@ -13,6 +18,33 @@
 
 #define PROXC_NULL  ((void *)-1)
 #define MAX_STACK_SIZE  (8 * 1024)
+/*
+ * max bytes of a stack in use for a RUN to run a child on it, which
+ * then has up to that much less stack than on its own, and stacks
+ * have no guard page
+ */
+#define MAX_INLINE_USED  512
+/* max number of free stacks kept by each scheduler for reuse */
+#define MAX_STACK_CACHE  32
+/* size of each arena that builders are allocated from */
+#define BUILD_ARENA_SIZE  (4 * 1024)
+/* scheduling rounds between polls for I/O while PROCs are ready */
+#define IO_POLL_ROUNDS  64
+/* max number of threads running blocking calls of PROCs */
+#define MAX_POOL_THREADS  16
+/* max number of spare threads the monitor hands schedulers to */
+#define MAX_SPARE_THREADS  16
+
+/* error returns of blocking operations */
+#define PROXC_EPOISON   (-1)
+#define PROXC_ETIMEOUT  (-2)
+#define PROXC_ECANCEL   (-3)
+#define PROXC_ENOMEM    (-4)
+#define PROXC_EINVAL    (-5)
+
+/* policies of tickers for missed ticks */
+#define PROXC_TICK_SKIP      0
+#define PROXC_TICK_COALESCE  1
 
 /* function prototype for PROC */
 typedef void (*ProcFxn)(void);
@@ -20,10 +52,29 @@ typedef void (*ProcFxn)(void);
 /* runtime relevant structs */
 struct Proc;
 struct Scheduler;
+struct Arena;
+struct Timer;
+struct Poller;
+struct IoFd;
+struct IoWait;
+struct Uring;
+struct PoolJob;
+struct Worker;
+struct Inject;
+struct InjectChan;
+struct SigChan;
+struct Ticker;
 
 /* CSP paradigm relevant structs */
 struct Chan;
 struct ChanEnd;
+struct Call;
+struct CallEnd;
+struct Barrier;
+struct Mutex;
+struct Sem;
+struct Cond;
+struct Future;
 
 enum BuildType {
     PROC_BUILD,
@@ -35,38 +86,69 @@ struct Builder;
 struct ProcBuild;
 struct ParBuild;
 struct SeqBuild;
+struct Template;
 
 enum GuardType {
     GUARD_SKIP,
     GUARD_TIME,
-    GUARD_CHAN
+    GUARD_CHAN,
+    GUARD_CALL,
+    GUARD_BAR,
+    GUARD_FUTURE,
+    GUARD_FD
 };
 
 struct Guard;
 struct Alt;
+struct AltEnd;
 
 /* typedefs for internal use */
 // Ctx is defined in context.h, as it is architecture dependent
 typedef struct Proc Proc;
 typedef struct Scheduler Scheduler;
+typedef struct Arena Arena;
+typedef struct Timer Timer;
+typedef struct Poller Poller;
+typedef struct IoFd IoFd;
+typedef struct IoWait IoWait;
+typedef struct Uring Uring;
+typedef struct PoolJob PoolJob;
+typedef struct Worker Worker;
+typedef struct ChanSource ChanSource;
+typedef struct Inject Inject;
+typedef struct InjectChan InjectChan;
+typedef struct SigChan SigChan;
+typedef struct Ticker Ticker;
 
 typedef struct ChanEnd ChanEnd;
 typedef struct Chan Chan;
+typedef struct CallEnd CallEnd;
+typedef struct Call Call;
+typedef struct Barrier Barrier;
+typedef struct Mutex Mutex;
+typedef struct Sem Sem;
+typedef struct Cond Cond;
+typedef struct Future Future;
 
 typedef struct ProcBuild ProcBuild;
 typedef struct ParBuild ParBuild;
 typedef struct SeqBuild SeqBuild;
 typedef struct Builder Builder;
+typedef struct Template Template;
 
 typedef struct Guard Guard;
 typedef struct Alt Alt;
+typedef struct AltEnd AltEnd;
 
 /* queue and tree declarations */
 TAILQ_HEAD(ProcQ, Proc);
 RB_HEAD(ProcRB_sleep, Proc);
 RB_HEAD(GuardRB_altsleep, Guard);
+RB_HEAD(TimerRB, Timer);
+TAILQ_HEAD(IoWaitQ, IoWait);
 
 TAILQ_HEAD(ChanEndQ, ChanEnd);
+TAILQ_HEAD(CallEndQ, CallEnd);
 
 TAILQ_HEAD(BuilderQ, Builder);
 
@@ -80,52 +162,222 @@ void ctx_madvise(Proc *proc);
 void  proc_mainfxn(Proc *proc);
 Proc* proc_self(void);
 int   proc_create(Proc **new_proc, ProcFxn fxn);
+int   proc_createbulk(Proc **new_procs, size_t num, ProcFxn fxn);
+void  proc_freebulk(Proc *procs);
 void  proc_free(Proc *proc);
+void  proc_release(Proc *proc);
+void  proc_reset(Proc *proc);
+int   proc_prepare(Proc *proc);
 int   proc_setargs(Proc *proc, va_list args);
+void  proc_setarg(Proc *proc, void *arg);
+void  proc_setblob(Proc *proc, const void *blob, size_t size);
 void  proc_yield(Proc *proc);
+void  proc_sleep(Proc *proc, uint64_t usec);
+void  proc_sleepuntil(Proc *proc, uint64_t deadline_us);
+int   proc_caninline(Proc *proc);
+void  proc_runinline(Proc *proc, Proc *child);
+void  proc_cancel(Proc *proc);
+int   proc_cancelpoint(Proc *proc);
 
 Scheduler* scheduler_self(void);
+Scheduler* scheduler_current(void);
 int  scheduler_create(Scheduler **new_sched);
 void scheduler_free(Scheduler *sched);
+void* scheduler_getstack(Scheduler *sched);
+void scheduler_putstack(Scheduler *sched, void *stack);
 void scheduler_addready(Proc *proc);
 void scheduler_remready(Proc *proc);
 void scheduler_addsleep(Proc *proc);
 void scheduler_remsleep(Proc *proc);
 void scheduler_addaltsleep(Guard *guard);
 void scheduler_remaltsleep(Guard *guard);
+void scheduler_addtimer(Scheduler *sched, Timer *timer);
+void scheduler_remtimer(Scheduler *sched, Timer *timer);
+int  scheduler_initwake(Scheduler *sched);
+void scheduler_notify(Scheduler *sched);
+void scheduler_pushremote(Scheduler *sched, Proc *proc);
 int  scheduler_run(void);
+int  scheduler_takeover(Worker *worker);
+int  scheduler_poll(Scheduler *sched, uint64_t usec);
+int64_t scheduler_nexttimeout(Scheduler *sched);
+
+Poller* io_create(void);
+void    io_free(Poller *poller);
+Poller* io_poller(Scheduler *sched);
+int     io_addsource(Poller *poller, IoWait *wait);
+void    io_remsource(Poller *poller, IoWait *wait);
+int     io_addwatch(Poller *poller, IoWait *wait);
+void    io_remwatch(Poller *poller, IoWait *wait);
+int     io_wait(int fd, uint32_t events, uint64_t usec);
+void    io_timeout(IoWait *wait);
+void    io_cancel(IoWait *wait);
+int     io_poll(Poller *poller, int64_t timeout_us);
+int     io_pollfds(struct pollfd *fds, nfds_t nfds, int timeout_ms);
+void    io_guardinit(Guard *guard, int fd, int events);
+int     io_altenable(Guard *guard);
+void    io_altdisable(Guard *guard);
+ssize_t io_read(int fd, void *buf, size_t count);
+ssize_t io_write(int fd, const void *buf, size_t count);
+int     io_accept(int fd, struct sockaddr *addr, socklen_t *addrlen);
+int     io_connect(int fd, const struct sockaddr *addr, socklen_t addrlen);
+void    io_forget(int fd);
+int     io_close(int fd);
+ssize_t io_pread(int fd, void *buf, size_t count, off_t offset);
+ssize_t io_pwrite(int fd, const void *buf, size_t count, off_t offset);
+int     io_fsync(int fd, int is_datasync);
+
+Uring*  uring_create(Scheduler *sched);
+void    uring_free(Scheduler *sched, Uring *uring);
+void    uring_flush(Uring *uring, int is_idle);
+ssize_t uring_preadv(Uring *uring, int fd, const struct iovec *iov, int num, off_t off);
+ssize_t uring_pwritev(Uring *uring, int fd, const struct iovec *iov, int num, off_t off);
+int     uring_fsync(Uring *uring, int fd, int is_datasync);
+
+void* pool_call(void *(*fxn)(void *), void *arg);
+void  pool_drain(Scheduler *sched);
+
+void monitor_bind(Scheduler *sched, Worker *worker);
+int  monitor_add(Scheduler *sched, uint64_t threshold_us);
+void monitor_remove(Scheduler *sched);
+void monitor_wait(Scheduler *sched);
+int  _monitor_enter(int can_move);
+int  _monitor_islost(void);
+void _monitor_leave(void);
+
+void source_init(ChanSource *src, Chan *chan,
+                 void* (*next)(ChanSource *src),
+                 void (*idle)(ChanSource *src),
+                 void (*free)(ChanSource *src));
+int  source_start(ChanSource *src);
+void source_free(ChanSource *src);
+
+void inject_register(Scheduler *sched);
+void inject_unregister(Scheduler *sched);
+int  inject_post(ProcFxn fxn, void *arg);
+int  inject_chan(Chan *chan, const void *data);
+void inject_drain(Scheduler *sched);
+void inject_free(Scheduler *sched);
+
+Chan* sigchan_create(const sigset_t *set);
+
+Chan* ticker_create(uint64_t period, uint64_t deadline, int policy);
+
+Arena* arena_create(size_t size);
+void   arena_free(Arena *arena);
+void*  arena_alloc(Arena *arena, size_t size);
+size_t arena_release(Arena *arena);
+void   arena_reset(Arena *arena);
 
 Chan *chan_create(size_t size);
 void chan_free(Chan *chan);
+void chan_poison(Chan *chan);
 int  chan_write(Chan *chan, void *data, size_t size);
 int  chan_read(Chan *chan, void *data, size_t size);
-int  chan_altenable(Chan *chan, Guard *guard);
-void chan_altdisable(Chan *chan, Guard *guard);
-void chan_altread(Chan *chan, Guard *guard, size_t size);
+int  chan_timedwrite(Chan *chan, void *data, size_t size, uint64_t usec);
+int  chan_timedread(Chan *chan, void *data, size_t size, uint64_t usec);
+void chan_timeout(ChanEnd *end);
+void chan_cancel(ChanEnd *end);
+int  chan_altenable(Chan *chan, ChanEnd *end);
+void chan_altdisable(Chan *chan, ChanEnd *end);
+int  chan_altread(Chan *chan, ChanEnd *end, size_t size);
+
+Call* call_create(size_t req_size, size_t resp_size);
+void  call_free(Call *call);
+int   call_call(Call *call, void *req, size_t req_size, void *resp, size_t resp_size);
+int   call_accept(Call *call, void *req, size_t size);
+int   call_reply(Call *call, void *resp, size_t size);
+int   call_altenable(Call *call, Guard *guard);
+void  call_altdisable(Call *call, Guard *guard);
+void  call_altaccept(Call *call, Guard *guard, size_t size);
+void  call_cancel(CallEnd *end);
+
+Barrier* barrier_create(size_t enrolled);
+void barrier_free(Barrier *bar);
+void barrier_enroll(Barrier *bar);
+void barrier_resign(Barrier *bar);
+int  barrier_sync(Barrier *bar);
+int  barrier_altenable(Barrier *bar, Guard *guard);
+void barrier_altdisable(Barrier *bar, Guard *guard);
+void barrier_altsync(Barrier *bar, Guard *guard);
+void barrier_cancel(Barrier *bar, Proc *proc);
+
+Future* future_create(size_t size);
+void future_free(Future *fut);
+void future_setresult(Future *fut, const void *data, size_t size);
+void future_complete(Future *fut, int status);
+int  future_await(Future *fut, void *out, size_t size);
+int  future_altenable(Future *fut, Guard *guard);
+void future_altdisable(Future *fut, Guard *guard);
+void future_altread(Future *fut, Guard *guard, size_t size);
+void future_cancel(Future *fut, Proc *proc);
+
+Mutex* mutex_create(void);
+void   mutex_free(Mutex *mtx);
+int    mutex_lock(Mutex *mtx);
+int    mutex_trylock(Mutex *mtx);
+void   mutex_unlock(Mutex *mtx);
+void   mutex_cancel(Mutex *mtx, Proc *proc);
+Sem*   semaphore_create(size_t count);
+void   semaphore_free(Sem *sem);
+int    semaphore_wait(Sem *sem);
+int    semaphore_trywait(Sem *sem);
+void   semaphore_post(Sem *sem);
+void   semaphore_cancel(Sem *sem, Proc *proc);
+Cond*  cond_create(void);
+void   cond_free(Cond *cond);
+int    cond_wait(Cond *cond, Mutex *mtx);
+void   cond_signal(Cond *cond);
+void   cond_broadcast(Cond *cond);
+void   cond_cancel(Cond *cond, Proc *proc);
 
 void* csp_create(enum BuildType type);
+ParBuild* csp_createparn(size_t num);
 void csp_free(Builder *build);
 int csp_insertchilds(size_t *num_childs, Builder *builder, struct BuilderQ *childQ, va_list vargs);
 void csp_runbuild(Builder *build);
+ProcBuild* csp_inlinebuild(Builder *root);
 void csp_cleanupbuild(Builder *build);
 void csp_parsebuild(Builder *build);
+Template* csp_tmplcreate(Builder *root);
+void csp_tmplfree(Template *tmpl);
+void csp_tmplreset(Template *tmpl);
+Future* csp_future(Builder *build);
+void csp_cancelbuild(Builder *build);
 
 Guard* alt_guardcreate(enum GuardType type, uint64_t usec, 
-                       Chan *chan, void *data, size_t size);
+                       void *obj, void *data, size_t size);
+void   alt_guardinit(Guard *guard, enum GuardType type, uint64_t usec,
+                     void *obj, void *data, size_t size);
 void   alt_guardfree(Guard *guard);
 void   alt_init(Alt *alt);
 void   alt_cleanup(Alt *alt);
 void   alt_addguard(Alt *alt, Guard *guard);
 int    alt_accept(Guard *guard);
+int    alt_acceptend(ChanEnd *end);
 int    alt_enable(Guard *guard);
 void   alt_disable(Guard *guard);
 int    alt_select(Alt *alt);
+int    alt_selectchans(Chan **chans, size_t num, void *out, size_t size);
+void   alt_cancel(Alt *alt);
 
 /* implementation of corresponding types and structs */
 /* must be after the declaration of the types */
 #include "proc.h"
+#include "io.h"
+#include "monitor.h"
 #include "scheduler.h"
+#include "uring.h"
+#include "pool.h"
+#include "source.h"
+#include "inject.h"
+#include "sigchan.h"
+#include "ticker.h"
+#include "arena.h"
 #include "chan.h"
+#include "call.h"
+#include "barrier.h"
+#include "lock.h"
+#include "future.h"
 #include "csp.h"
 #include "alt.h"
 
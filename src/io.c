@@ -0,0 +1,815 @@
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <time.h>
+
+#include "internal.h"
+
+/* max number of events reaped by each poll */
+#define IO_MAX_EVENTS  64
+
+Poller* io_create(void)
+{
+    Poller *poller;
+    if (!(poller = malloc(sizeof(Poller)))) {
+        PERROR("malloc failed for Poller\n");
+        return NULL;
+    }
+
+    if ((poller->epfd = epoll_create1(EPOLL_CLOEXEC)) == -1) {
+        PERROR("epoll_create1 failed\n");
+        free(poller);
+        return NULL;
+    }
+
+    PDEBUG("POLLER created\n");
+
+    poller->num_waits   = 0;
+    poller->num_sources = 0;
+    poller->num_fds     = 0;
+    poller->fds       = NULL;
+
+    return poller;
+}
+
+void io_free(Poller *poller)
+{
+    if (!poller) return;
+
+    for (size_t i = 0; i < poller->num_fds; ++i) {
+        free(poller->fds[i]);
+    }
+    free(poller->fds);
+    close(poller->epfd);
+    free(poller);
+}
+
+static
+IoFd* _io_getfd(Poller *poller, int fd)
+{
+    if (fd < 0) {
+        return NULL;
+    }
+    if ((size_t)fd >= poller->num_fds) {
+        size_t num = (poller->num_fds > 0) ? poller->num_fds : 64;
+        while (num <= (size_t)fd) {
+            num *= 2;
+        }
+        IoFd **fds = realloc(poller->fds, num * sizeof(IoFd *));
+        if (!fds) {
+            PERROR("realloc failed for IoFd table\n");
+            return NULL;
+        }
+        memset(fds + poller->num_fds, 0, (num - poller->num_fds) * sizeof(IoFd *));
+        poller->fds     = fds;
+        poller->num_fds = num;
+    }
+
+    IoFd *iofd = poller->fds[fd];
+    if (!iofd) {
+        if (!(iofd = malloc(sizeof(IoFd)))) {
+            PERROR("malloc failed for IoFd\n");
+            return NULL;
+        }
+        iofd->events    = 0;
+        iofd->mode      = IO_MODE_UNKNOWN;
+        iofd->flags     = 0;
+        iofd->num_calls = 0;
+        TAILQ_INIT(&iofd->waitQ);
+        poller->fds[fd] = iofd;
+    }
+    return iofd;
+}
+
+/*
+ * Registers the union of the events waited on for fd. A fd which
+ * is closed is silently dropped by epoll, so a failed MOD is
+ * retried as an ADD, and a failed DEL is ignored.
+ */
+static
+int _io_update(Poller *poller, int fd, IoFd *iofd)
+{
+    uint32_t events = 0;
+    IoWait *wait;
+    TAILQ_FOREACH(wait, &iofd->waitQ, node) {
+        events |= wait->events;
+    }
+    if (events == iofd->events) {
+        return 0;
+    }
+
+    struct epoll_event ev = { .events = events, .data.fd = fd };
+    int ret = 0;
+    if (events == 0) {
+        epoll_ctl(poller->epfd, EPOLL_CTL_DEL, fd, &ev);
+    }
+    else if (iofd->events == 0) {
+        ret = epoll_ctl(poller->epfd, EPOLL_CTL_ADD, fd, &ev);
+        if (ret == -1 && errno == EEXIST) {
+            ret = epoll_ctl(poller->epfd, EPOLL_CTL_MOD, fd, &ev);
+        }
+    }
+    else {
+        ret = epoll_ctl(poller->epfd, EPOLL_CTL_MOD, fd, &ev);
+        if (ret == -1 && errno == ENOENT) {
+            ret = epoll_ctl(poller->epfd, EPOLL_CTL_ADD, fd, &ev);
+        }
+    }
+    if (ret == -1) {
+        return errno;
+    }
+    iofd->events = events;
+    return 0;
+}
+
+Poller* io_poller(Scheduler *sched)
+{
+    if (!sched->poller) {
+        sched->poller = io_create();
+    }
+    return sched->poller;
+}
+
+/* returns 0, or errno if the fd of wait cannot be polled */
+static
+int _io_addwait(Poller *poller, IoWait *wait)
+{
+    IoFd *iofd = _io_getfd(poller, wait->fd);
+    if (!iofd) {
+        return (wait->fd < 0) ? EBADF : ENOMEM;
+    }
+
+    TAILQ_INSERT_TAIL(&iofd->waitQ, wait, node);
+    int ret;
+    if ((ret = _io_update(poller, wait->fd, iofd))) {
+        TAILQ_REMOVE(&iofd->waitQ, wait, node);
+        return ret;
+    }
+    ++poller->num_waits;
+    return 0;
+}
+
+static
+void _io_remwait(Poller *poller, IoWait *wait)
+{
+    IoFd *iofd = poller->fds[wait->fd];
+    TAILQ_REMOVE(&iofd->waitQ, wait, node);
+    --poller->num_waits;
+    _io_update(poller, wait->fd, iofd);
+}
+
+/*
+ * A source is only polled while no PROC is ready, as what it wakes
+ * for is also checked each round, and is not work of the scheduler.
+ */
+int io_addsource(Poller *poller, IoWait *wait)
+{
+    int ret = io_addwatch(poller, wait);
+    if (ret == 0) {
+        ++poller->num_sources;
+    }
+    return ret;
+}
+
+void io_remsource(Poller *poller, IoWait *wait)
+{
+    if (!poller) return;
+
+    io_remwatch(poller, wait);
+    --poller->num_sources;
+}
+
+/* a watch calls fxn on behalf of PROCs, polled as often as their waits */
+int io_addwatch(Poller *poller, IoWait *wait)
+{
+    ASSERT_NOTNULL(poller);
+    ASSERT_NOTNULL(wait->fxn);
+
+    wait->proc  = NULL;
+    wait->guard = NULL;
+    return _io_addwait(poller, wait);
+}
+
+void io_remwatch(Poller *poller, IoWait *wait)
+{
+    if (!poller) return;
+
+    _io_remwait(poller, wait);
+}
+
+static
+void _io_resume(IoWait *wait, int status)
+{
+    Proc *proc = wait->proc;
+    if (proc->sleep_us > 0) {
+        scheduler_remsleep(proc);
+        proc->sleep_us = 0;
+    }
+    wait->status = status;
+    scheduler_addready(proc);
+}
+
+/*
+ * Parks the PROC until fd has any of events ready, and returns
+ * the ready events, PROXC_ETIMEOUT or PROXC_ECANCEL. Returns 0
+ * with errno set if fd cannot be polled, such as a regular file.
+ */
+int io_wait(int fd, uint32_t events, uint64_t usec)
+{
+    Proc *proc = proc_self();
+    Scheduler *sched = proc->sched;
+
+    if (UNLIKELY(proc_cancelpoint(proc))) {
+        return PROXC_ECANCEL;
+    }
+    if (usec == 0) {
+        return PROXC_ETIMEOUT;
+    }
+
+    Poller *poller = io_poller(sched);
+    if (!poller) {
+        return 0;
+    }
+
+    struct IoWait wait = {
+        .fd     = fd,
+        .events = events,
+        .status = 0,
+        .proc   = proc,
+        .guard  = NULL,
+        .fxn    = NULL,
+        .arg    = NULL
+    };
+    int ret;
+    if ((ret = _io_addwait(poller, &wait))) {
+        errno = ret;
+        return 0;
+    }
+
+    if (usec != IO_NO_TIMEOUT) {
+        proc->sleep_us = gettimestamp() + usec;
+        scheduler_addsleep(proc);
+    }
+    proc->io_wait = &wait;
+
+    PDEBUG("IO wait, park\n");
+
+    /* yield until fd is ready, timed out or cancelled */
+    proc->state = PROC_IOWAIT;
+    proc_yield(proc);
+    proc->sleep_us = 0;
+    proc->io_wait  = NULL;
+    return wait.status;
+}
+
+void io_timeout(IoWait *wait)
+{
+    ASSERT_NOTNULL(wait);
+
+    PDEBUG("IO wait timed out\n");
+    _io_remwait(wait->proc->sched->poller, wait);
+    wait->status = PROXC_ETIMEOUT;
+}
+
+/*
+ * Called when the PROC of a wait is cancelled.
+ */
+void io_cancel(IoWait *wait)
+{
+    ASSERT_NOTNULL(wait);
+
+    PDEBUG("IO wait cancelled\n");
+    _io_remwait(wait->proc->sched->poller, wait);
+    _io_resume(wait, PROXC_ECANCEL);
+}
+
+/* set once epoll_pwait2 is found not to be supported by the kernel */
+static int g_io_nopwait2 = 0;
+
+/*
+ * Waits for events for timeout_us, to the us with epoll_pwait2,
+ * or else in ms rounded up, so a timeout is never polled early.
+ */
+static inline
+int _io_wait(Poller *poller, struct epoll_event *events, int64_t timeout_us)
+{
+#if defined(__GLIBC__) && __GLIBC_PREREQ(2, 35)
+    if (timeout_us > 0 && !__atomic_load_n(&g_io_nopwait2, __ATOMIC_RELAXED)) {
+        struct timespec ts = {
+            .tv_sec  = timeout_us / 1000000,
+            .tv_nsec = (timeout_us % 1000000) * 1000
+        };
+        int num = epoll_pwait2(poller->epfd, events, IO_MAX_EVENTS, &ts, NULL);
+        if (num != -1 || errno != ENOSYS) {
+            return num;
+        }
+        __atomic_store_n(&g_io_nopwait2, 1, __ATOMIC_RELAXED);
+    }
+#endif
+    int timeout_ms = (timeout_us > 0)
+                   ? (int)((timeout_us + 999) / 1000)
+                   : (int)timeout_us;
+    return epoll_wait(poller->epfd, events, IO_MAX_EVENTS, timeout_ms);
+}
+
+/*
+ * Polls for ready fds for at most timeout_us, -1 is infinite, and
+ * resumes the PROCs waiting on them. Errors and hangups resume
+ * all waits on the fd, their following operation reports it.
+ * Returns the number of fds ready.
+ */
+int io_poll(Poller *poller, int64_t timeout_us)
+{
+    ASSERT_NOTNULL(poller);
+
+    struct epoll_event events[IO_MAX_EVENTS];
+    int num = _io_wait(poller, events, timeout_us);
+    if (num == -1) {
+        if (errno != EINTR) {
+            PERROR("epoll_wait failed\n");
+        }
+        return 0;
+    }
+
+    for (int i = 0; i < num; ++i) {
+        int fd = events[i].data.fd;
+        uint32_t revents = events[i].events;
+        if (revents & (EPOLLERR | EPOLLHUP)) {
+            revents |= EPOLLIN | EPOLLOUT;
+        }
+
+        IoFd *iofd = poller->fds[fd];
+        IoWait *wait, *next;
+        for (wait = TAILQ_FIRST(&iofd->waitQ); wait; wait = next) {
+            next = TAILQ_NEXT(wait, node);
+            if (!(wait->events & revents)) {
+                continue;
+            }
+            if (wait->fxn) {
+                wait->fxn(wait->arg);
+                continue;
+            }
+            TAILQ_REMOVE(&iofd->waitQ, wait, node);
+            --poller->num_waits;
+            wait->status = (int)(wait->events & revents);
+            if (!wait->guard) {
+                _io_resume(wait, wait->status);
+                continue;
+            }
+            /* a guard is only disabled by its ALT */
+            wait->guard->in_io = 2;
+            Proc *alt_proc = wait->guard->alt->proc;
+            if (alt_proc->state == PROC_ALTWAIT) {
+                if (alt_accept(wait->guard)) {
+                    scheduler_addready(alt_proc);
+                }
+            }
+        }
+        _io_update(poller, fd, iofd);
+    }
+
+    return num;
+}
+
+/*
+ * As poll(), but parks the PROC on an ALT of fd guards, and a time
+ * guard if timeout_ms is not -1. Cancellation returns -1 with
+ * errno ECANCELED.
+ */
+int io_pollfds(struct pollfd *fds, nfds_t nfds, int timeout_ms)
+{
+    if (UNLIKELY(monitor_islost())) {
+        return poll(fds, nfds, timeout_ms);
+    }
+
+    int ret = poll(fds, nfds, 0);
+    if (ret != 0 || timeout_ms == 0) {
+        return ret;
+    }
+
+    uint64_t deadline_us = (timeout_ms > 0)
+                         ? gettimestamp() + (uint64_t)timeout_ms * 1000
+                         : 0;
+    for (;;) {
+        Alt alt;
+        alt_init(&alt);
+        for (nfds_t i = 0; i < nfds; ++i) {
+            Guard *guard = (fds[i].fd >= 0)
+                ? alt_guardcreate(GUARD_FD, 0, NULL, NULL, 0)
+                : NULL;
+            if (guard) {
+                io_guardinit(guard, fds[i].fd, fds[i].events);
+            }
+            alt_addguard(&alt, guard);
+        }
+        if (deadline_us) {
+            alt_addguard(&alt, alt_guardcreate(GUARD_TIME, deadline_us, NULL, NULL, 0));
+        }
+        int key = alt_select(&alt);
+        alt_cleanup(&alt);
+
+        if (key == PROXC_ECANCEL) {
+            errno = ECANCELED;
+            return -1;
+        }
+        /* a fd guard may be raced by another reader, then wait on */
+        if ((ret = poll(fds, nfds, 0)) != 0 || key == (int)nfds) {
+            return ret;
+        }
+    }
+}
+
+/*
+ * events are POLLIN and POLLOUT, as for poll().
+ */
+void io_guardinit(Guard *guard, int fd, int events)
+{
+    ASSERT_NOTNULL(guard);
+
+    guard->io_wait.fd     = fd;
+    guard->io_wait.events = ((events & POLLIN)  ? EPOLLIN  : 0)
+                          | ((events & POLLOUT) ? EPOLLOUT : 0);
+    guard->io_wait.status = 0;
+    guard->io_wait.guard  = guard;
+    guard->io_wait.fxn    = NULL;
+    guard->io_wait.arg    = NULL;
+}
+
+/*
+ * The fd is checked with a zero timeout poll first, as a ready
+ * fd is otherwise not seen until the scheduler polls next, and
+ * a fd which cannot be polled is reported ready, as poll does
+ * for regular files. A negative fd is ignored as by poll, and the
+ * guard never becomes ready.
+ */
+int io_altenable(Guard *guard)
+{
+    ASSERT_NOTNULL(guard);
+
+    IoWait *wait = &guard->io_wait;
+    if (wait->fd < 0) {
+        return 0;
+    }
+    struct pollfd pfd = {
+        .fd     = wait->fd,
+        .events = (short)(((wait->events & EPOLLIN)  ? POLLIN  : 0)
+                        | ((wait->events & EPOLLOUT) ? POLLOUT : 0))
+    };
+    if (poll(&pfd, 1, 0) != 0) {
+        return 1;
+    }
+
+    wait->proc = guard->alt->proc;
+    Poller *poller = io_poller(wait->proc->sched);
+    if (!poller || _io_addwait(poller, wait)) {
+        return 1;
+    }
+    guard->in_io = 1;
+    return 0;
+}
+
+void io_altdisable(Guard *guard)
+{
+    ASSERT_NOTNULL(guard);
+
+    IoWait *wait = &guard->io_wait;
+    _io_remwait(wait->proc->sched->poller, wait);
+    guard->in_io = 0;
+}
+
+/*
+ * On a thread its scheduler was retaken from, which runs no other
+ * PROC until it moves, fds are used with the flags of the caller,
+ * and waited on with a plain poll, as the poller is not its own.
+ */
+static IoFd g_io_lostfd = {
+    .mode  = IO_MODE_FD,
+    .flags = O_NONBLOCK
+};
+
+/*
+ * The IoFd of fd in the poller of the scheduler, with the mode of
+ * fd cached at its first I/O. The cache is dropped as fd is closed
+ * by io_close, and as a socket is found to be reused as another fd.
+ * Returns NULL with errno set on failure.
+ */
+static
+IoFd* _io_mode(int fd)
+{
+    if (UNLIKELY(monitor_islost())) {
+        return &g_io_lostfd;
+    }
+
+    Poller *poller;
+    IoFd *iofd;
+    if (!(poller = io_poller(scheduler_self())) || !(iofd = _io_getfd(poller, fd))) {
+        errno = (fd < 0) ? EBADF : ENOMEM;
+        return NULL;
+    }
+    if (LIKELY(iofd->mode != IO_MODE_UNKNOWN)) {
+        return iofd;
+    }
+
+    int flags = fcntl(fd, F_GETFL);
+    if (flags == -1) {
+        return NULL;
+    }
+    int type;
+    socklen_t len = sizeof(type);
+    iofd->mode = (getsockopt(fd, SOL_SOCKET, SO_TYPE, &type, &len) == 0)
+               ? IO_MODE_SOCK
+               : IO_MODE_FD;
+    iofd->flags = flags;
+    return iofd;
+}
+
+/* makes fd non-blocking for a call, unless the caller set it so */
+static inline
+int _io_enter(int fd, IoFd *iofd)
+{
+    if ((iofd->flags & O_NONBLOCK) || iofd->num_calls++ > 0) {
+        return 0;
+    }
+    if (fcntl(fd, F_SETFL, iofd->flags | O_NONBLOCK) == -1) {
+        iofd->num_calls = 0;
+        return -1;
+    }
+    return 0;
+}
+
+/* restores the flags of the caller as the last call on fd returns */
+static inline
+void _io_leave(int fd, IoFd *iofd)
+{
+    if ((iofd->flags & O_NONBLOCK) || --iofd->num_calls > 0) {
+        return;
+    }
+    int saved = errno;
+    fcntl(fd, F_SETFL, iofd->flags);
+    errno = saved;
+}
+
+static inline
+int _io_again(void)
+{
+    return errno == EAGAIN || errno == EWOULDBLOCK;
+}
+
+/* parks until fd is ready, else returns -1 with errno set */
+static inline
+int _io_park(int fd, uint32_t events)
+{
+    /* the thread runs no other PROC, see g_io_lostfd */
+    if (UNLIKELY(monitor_islost())) {
+        struct pollfd pfd = {
+            .fd     = fd,
+            .events = (short)(((events & EPOLLIN)  ? POLLIN  : 0)
+                            | ((events & EPOLLOUT) ? POLLOUT : 0))
+        };
+        int ret;
+        while ((ret = poll(&pfd, 1, -1)) == -1 && errno == EINTR)
+            ;
+        return (ret > 0) ? 0 : -1;
+    }
+
+    int status = io_wait(fd, events, IO_NO_TIMEOUT);
+    if (LIKELY(status > 0)) {
+        return 0;
+    }
+    if (status == PROXC_ECANCEL) {
+        errno = ECANCELED;
+    }
+    return -1;
+}
+
+/*
+ * Sockets are read and written with MSG_DONTWAIT, so their flags
+ * are never changed, and other fds are made non-blocking for the
+ * call. A socket found closed and reused as another fd is probed
+ * again.
+ */
+ssize_t io_read(int fd, void *buf, size_t count)
+{
+    IoFd *iofd;
+    if (!(iofd = _io_mode(fd))) {
+        return -1;
+    }
+
+    ssize_t ret;
+    if (LIKELY(iofd->mode == IO_MODE_SOCK)) {
+        for (;;) {
+            if ((ret = recv(fd, buf, count, MSG_DONTWAIT)) >= 0 || !_io_again()) {
+                if (ret == -1 && errno == EINTR) continue;
+                if (ret == -1 && errno == ENOTSOCK) break;
+                return ret;
+            }
+            if (_io_park(fd, EPOLLIN)) {
+                return -1;
+            }
+        }
+        iofd->mode = IO_MODE_UNKNOWN;
+        if (!(iofd = _io_mode(fd))) {
+            return -1;
+        }
+    }
+
+    if (_io_enter(fd, iofd)) {
+        return -1;
+    }
+    for (;;) {
+        if ((ret = read(fd, buf, count)) >= 0 || !_io_again()) {
+            if (ret == -1 && errno == EINTR) continue;
+            break;
+        }
+        if (_io_park(fd, EPOLLIN)) {
+            ret = -1;
+            break;
+        }
+    }
+    _io_leave(fd, iofd);
+    return ret;
+}
+
+ssize_t io_write(int fd, const void *buf, size_t count)
+{
+    IoFd *iofd;
+    if (!(iofd = _io_mode(fd))) {
+        return -1;
+    }
+
+    ssize_t ret;
+    if (LIKELY(iofd->mode == IO_MODE_SOCK)) {
+        for (;;) {
+            if ((ret = send(fd, buf, count, MSG_DONTWAIT)) >= 0 || !_io_again()) {
+                if (ret == -1 && errno == EINTR) continue;
+                if (ret == -1 && errno == ENOTSOCK) break;
+                return ret;
+            }
+            if (_io_park(fd, EPOLLOUT)) {
+                return -1;
+            }
+        }
+        iofd->mode = IO_MODE_UNKNOWN;
+        if (!(iofd = _io_mode(fd))) {
+            return -1;
+        }
+    }
+
+    if (_io_enter(fd, iofd)) {
+        return -1;
+    }
+    for (;;) {
+        if ((ret = write(fd, buf, count)) >= 0 || !_io_again()) {
+            if (ret == -1 && errno == EINTR) continue;
+            break;
+        }
+        if (_io_park(fd, EPOLLOUT)) {
+            ret = -1;
+            break;
+        }
+    }
+    _io_leave(fd, iofd);
+    return ret;
+}
+
+/* accept takes no MSG_DONTWAIT, so the socket is made non-blocking */
+int io_accept(int fd, struct sockaddr *addr, socklen_t *addrlen)
+{
+    IoFd *iofd;
+    if (!(iofd = _io_mode(fd)) || _io_enter(fd, iofd)) {
+        return -1;
+    }
+
+    int ret;
+    for (;;) {
+        if ((ret = accept(fd, addr, addrlen)) >= 0 || !_io_again()) {
+            if (ret == -1 && errno == EINTR) continue;
+            break;
+        }
+        if (_io_park(fd, EPOLLIN)) {
+            ret = -1;
+            break;
+        }
+    }
+    _io_leave(fd, iofd);
+    return ret;
+}
+
+/*
+ * A non-blocking connect completes when fd is writable, and its
+ * result is then read from SO_ERROR.
+ */
+int io_connect(int fd, const struct sockaddr *addr, socklen_t addrlen)
+{
+    IoFd *iofd;
+    if (!(iofd = _io_mode(fd)) || _io_enter(fd, iofd)) {
+        return -1;
+    }
+
+    int ret = connect(fd, addr, addrlen);
+    if (ret == -1 && errno == EINPROGRESS && (ret = _io_park(fd, EPOLLOUT)) == 0) {
+        int err;
+        socklen_t len = sizeof(err);
+        if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) == -1) {
+            ret = -1;
+        }
+        else if (err) {
+            errno = err;
+            ret = -1;
+        }
+    }
+    _io_leave(fd, iofd);
+    return ret;
+}
+
+/* drops the mode cached for fd on the scheduler of the caller */
+void io_forget(int fd)
+{
+    Scheduler *sched = scheduler_current();
+    if (monitor_islost() || !sched || !sched->poller || fd < 0 || (size_t)fd >= sched->poller->num_fds) {
+        return;
+    }
+    IoFd *iofd = sched->poller->fds[fd];
+    if (iofd) {
+        iofd->mode = IO_MODE_UNKNOWN;
+    }
+}
+
+int io_close(int fd)
+{
+    io_forget(fd);
+    return close(fd);
+}
+
+#ifdef PROXC_IO_URING
+static inline
+Uring* _io_uring(void)
+{
+    if (UNLIKELY(monitor_islost())) {
+        return NULL;
+    }
+    Scheduler *sched = scheduler_self();
+    if (UNLIKELY(!sched->uring && !sched->no_uring)) {
+        sched->uring    = uring_create(sched);
+        sched->no_uring = !sched->uring;
+    }
+    return sched->uring;
+}
+
+static inline
+ssize_t _io_uringres(ssize_t res)
+{
+    if (res < 0) {
+        errno = (int)-res;
+        return -1;
+    }
+    return res;
+}
+#endif
+
+/*
+ * File I/O, which is always ready for epoll. With io_uring, the
+ * PROC parks while the operation is in flight, else these are
+ * the plain syscalls, which block the scheduler.
+ */
+ssize_t io_pread(int fd, void *buf, size_t count, off_t offset)
+{
+#ifdef PROXC_IO_URING
+    Uring *uring = _io_uring();
+    if (LIKELY(uring)) {
+        struct iovec iov = { .iov_base = buf, .iov_len = count };
+        return _io_uringres(uring_preadv(uring, fd, &iov, 1, offset));
+    }
+#endif
+    return pread(fd, buf, count, offset);
+}
+
+ssize_t io_pwrite(int fd, const void *buf, size_t count, off_t offset)
+{
+#ifdef PROXC_IO_URING
+    Uring *uring = _io_uring();
+    if (LIKELY(uring)) {
+        struct iovec iov = { .iov_base = (void *)buf, .iov_len = count };
+        return _io_uringres(uring_pwritev(uring, fd, &iov, 1, offset));
+    }
+#endif
+    return pwrite(fd, buf, count, offset);
+}
+
+int io_fsync(int fd, int is_datasync)
+{
+#ifdef PROXC_IO_URING
+    Uring *uring = _io_uring();
+    if (LIKELY(uring)) {
+        return (int)_io_uringres(uring_fsync(uring, fd, is_datasync));
+    }
+#endif
+    return is_datasync ? fdatasync(fd) : fsync(fd);
+}
@@ -0,0 +1,65 @@
+
+#ifndef IO_H__
+#define IO_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "internal.h"
+
+#define IO_NO_TIMEOUT  ((uint64_t)-1)
+
+/* 
+ * A PROC, or the guard of an ALT, waiting on events of a fd. A
+ * source or watch of the runtime has fxn set instead, which is
+ * called with arg on each poll the fd is ready, until removed.
+ */
+struct IoWait {
+    int       fd;
+    uint32_t  events;
+    /* ready events, or error if negative */
+    int       status;
+
+    struct Proc   *proc;
+    struct Guard  *guard;
+
+    void  (*fxn)(void *arg);
+    void  *arg;
+
+    TAILQ_ENTRY(IoWait)  node;
+};
+
+/* how the I/O of PROCs keeps a fd from blocking, probed at its first */
+enum IoMode {
+    IO_MODE_UNKNOWN = 0,
+    /* read and written with MSG_DONTWAIT, flags left alone */
+    IO_MODE_SOCK,
+    /* made non-blocking for each call, then restored */
+    IO_MODE_FD,
+};
+
+/* waits on a fd, and the union of their events registered in epoll */
+struct IoFd {
+    uint32_t  events;
+    struct IoWaitQ  waitQ;
+
+    enum IoMode  mode;
+    /* file status flags of the caller, as cached with mode */
+    int  flags;
+    /* calls made non-blocking, the last restores flags */
+    int  num_calls;
+};
+
+/* epoll instance of a scheduler, created at the first wait */
+struct Poller {
+    int     epfd;
+    size_t  num_waits;
+    /* of the waits, those persistent sources of the scheduler */
+    size_t  num_sources;
+
+    /* indexed by fd */
+    size_t  num_fds;
+    struct IoFd  **fds;
+};
+
+#endif /* IO_H__ */
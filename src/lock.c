@@ -0,0 +1,378 @@
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+
+#include "internal.h"
+
+/*
+ * Parks proc in the waitQ of obj, and returns 1 when signaled,
+ * or PROXC_ECANCEL if proc was cancelled while waiting.
+ */
+static inline
+int _lock_park(struct ProcQ *waitQ, void *obj, Proc *proc, enum ProcState state)
+{
+    TAILQ_INSERT_TAIL(waitQ, proc, readyQ_next);
+
+    // >> release lock >>
+
+    /* yield until the waitQ is signaled */
+    proc->wait_obj    = obj;
+    proc->wait_status = 1;
+    proc->state = state;
+    proc_yield(proc);
+    proc->wait_obj = NULL;
+    return proc->wait_status;
+}
+
+static inline
+void _lock_cancel(struct ProcQ *waitQ, Proc *proc)
+{
+    // << acquire lock <<
+    TAILQ_REMOVE(waitQ, proc, readyQ_next);
+    // >> release lock >>
+
+    proc->wait_status = PROXC_ECANCEL;
+    scheduler_addready(proc);
+}
+
+static inline
+Proc* _lock_unpark(struct ProcQ *waitQ)
+{
+    Proc *proc = TAILQ_FIRST(waitQ);
+    if (proc) {
+        TAILQ_REMOVE(waitQ, proc, readyQ_next);
+    }
+    return proc;
+}
+
+Mutex* mutex_create(void)
+{
+    Mutex *mtx;
+
+    /* alloc MUTEX struct */
+    if (!(mtx = malloc(sizeof(Mutex)))) {
+        PERROR("malloc failed for Mutex\n");
+        return NULL;
+    }
+
+    /* set MUTEX members */
+    mtx->owner = NULL;
+    TAILQ_INIT(&mtx->waitQ);
+
+    return mtx;
+}
+
+void mutex_free(Mutex *mtx)
+{
+    if (!mtx) return;
+
+    ASSERT_TRUE(TAILQ_EMPTY(&mtx->waitQ));
+    free(mtx);
+}
+
+/*
+ * Returns 1 when locked, or PROXC_ECANCEL if the PROC is
+ * cancelled before it gets the mutex, which is then not locked.
+ */
+int mutex_lock(Mutex *mtx)
+{
+    ASSERT_NOTNULL(mtx);
+
+    Proc *proc = proc_self();
+
+    // << acquire lock <<
+
+    if (!mtx->owner) {
+        mtx->owner = proc;
+
+        // >> release lock >>
+
+        return 1;
+    }
+    ASSERT_NEQ(mtx->owner, proc);
+
+    if (UNLIKELY(proc_cancelpoint(proc))) {
+        // >> release lock >>
+        return PROXC_ECANCEL;
+    }
+
+    PDEBUG("MUTEX locked, enqueue\n");
+
+    /* ownership is handed over by unlock */
+    int ret = _lock_park(&mtx->waitQ, mtx, proc, PROC_LOCKWAIT);
+    ASSERT_TRUE(ret < 0 || mtx->owner == proc);
+    return ret;
+}
+
+int mutex_trylock(Mutex *mtx)
+{
+    ASSERT_NOTNULL(mtx);
+
+    Proc *proc = proc_self();
+
+    // << acquire lock <<
+
+    int ret = 0;
+    if (!mtx->owner) {
+        mtx->owner = proc;
+        ret = 1;
+    }
+
+    // >> release lock >>
+
+    return ret;
+}
+
+void mutex_unlock(Mutex *mtx)
+{
+    ASSERT_NOTNULL(mtx);
+    ASSERT_EQ(mtx->owner, proc_self());
+
+    // << acquire lock <<
+
+    /* hand over ownership directly to first waiting PROC */
+    Proc *next = _lock_unpark(&mtx->waitQ);
+    mtx->owner = next;
+
+    // >> release lock >>
+
+    if (next) {
+        PDEBUG("MUTEX unlock, handover\n");
+        scheduler_addready(next);
+    }
+}
+
+void mutex_cancel(Mutex *mtx, Proc *proc)
+{
+    ASSERT_NOTNULL(mtx);
+
+    PDEBUG("MUTEX lock cancelled\n");
+    _lock_cancel(&mtx->waitQ, proc);
+}
+
+Sem* semaphore_create(size_t count)
+{
+    Sem *sem;
+
+    /* alloc SEM struct */
+    if (!(sem = malloc(sizeof(Sem)))) {
+        PERROR("malloc failed for Sem\n");
+        return NULL;
+    }
+
+    /* set SEM members */
+    sem->count = count;
+    TAILQ_INIT(&sem->waitQ);
+
+    return sem;
+}
+
+void semaphore_free(Sem *sem)
+{
+    if (!sem) return;
+
+    ASSERT_TRUE(TAILQ_EMPTY(&sem->waitQ));
+    free(sem);
+}
+
+/*
+ * Returns 1 when a unit is taken, or PROXC_ECANCEL if the PROC
+ * is cancelled before it gets one.
+ */
+int semaphore_wait(Sem *sem)
+{
+    ASSERT_NOTNULL(sem);
+
+    Proc *proc = proc_self();
+
+    // << acquire lock <<
+
+    if (sem->count > 0) {
+        --sem->count;
+
+        // >> release lock >>
+
+        return 1;
+    }
+
+    if (UNLIKELY(proc_cancelpoint(proc))) {
+        // >> release lock >>
+        return PROXC_ECANCEL;
+    }
+
+    PDEBUG("SEM empty, enqueue\n");
+
+    /* the unit is handed over by post */
+    return _lock_park(&sem->waitQ, sem, proc, PROC_SEMWAIT);
+}
+
+int semaphore_trywait(Sem *sem)
+{
+    ASSERT_NOTNULL(sem);
+
+    // << acquire lock <<
+
+    int ret = 0;
+    if (sem->count > 0) {
+        --sem->count;
+        ret = 1;
+    }
+
+    // >> release lock >>
+
+    return ret;
+}
+
+void semaphore_post(Sem *sem)
+{
+    ASSERT_NOTNULL(sem);
+
+    // << acquire lock <<
+
+    Proc *next = _lock_unpark(&sem->waitQ);
+    if (!next) {
+        ++sem->count;
+    }
+
+    // >> release lock >>
+
+    if (next) {
+        PDEBUG("SEM post, handover\n");
+        scheduler_addready(next);
+    }
+}
+
+void semaphore_cancel(Sem *sem, Proc *proc)
+{
+    ASSERT_NOTNULL(sem);
+
+    PDEBUG("SEM wait cancelled\n");
+    _lock_cancel(&sem->waitQ, proc);
+}
+
+Cond* cond_create(void)
+{
+    Cond *cond;
+
+    /* alloc COND struct */
+    if (!(cond = malloc(sizeof(Cond)))) {
+        PERROR("malloc failed for Cond\n");
+        return NULL;
+    }
+
+    /* set COND members */
+    cond->mtx = NULL;
+    TAILQ_INIT(&cond->waitQ);
+
+    return cond;
+}
+
+void cond_free(Cond *cond)
+{
+    if (!cond) return;
+
+    ASSERT_TRUE(TAILQ_EMPTY(&cond->waitQ));
+    free(cond);
+}
+
+/*
+ * Returns 1 when signaled, or PROXC_ECANCEL if the PROC is
+ * cancelled. The mutex is owned on return in either case.
+ */
+int cond_wait(Cond *cond, Mutex *mtx)
+{
+    ASSERT_NOTNULL(cond);
+    ASSERT_NOTNULL(mtx);
+    ASSERT_TRUE(!cond->mtx || cond->mtx == mtx);
+
+    Proc *proc = proc_self();
+
+    if (UNLIKELY(proc_cancelpoint(proc))) {
+        return PROXC_ECANCEL;
+    }
+
+    // << acquire lock <<
+
+    cond->mtx = mtx;
+    mutex_unlock(mtx);
+
+    PDEBUG("COND wait, enqueue\n");
+
+    /* signal moves this PROC over to the mutex, so */
+    /* when resumed the mutex is allready owned */
+    int ret = _lock_park(&cond->waitQ, cond, proc, PROC_CONDWAIT);
+    ASSERT_EQ(mtx->owner, proc);
+    return ret;
+}
+
+/*
+ * Instead of waking the waiting PROC, only to have it block
+ * on the mutex again, move it directly over to the mutex waitQ.
+ */
+static
+void _cond_move(Cond *cond, Proc *proc)
+{
+    /* from here, it is only resumed by owning the mutex */
+    proc->wait_obj = NULL;
+
+    Mutex *mtx = cond->mtx;
+    if (!mtx->owner) {
+        mtx->owner = proc;
+        scheduler_addready(proc);
+    }
+    else {
+        TAILQ_INSERT_TAIL(&mtx->waitQ, proc, readyQ_next);
+    }
+}
+
+void cond_signal(Cond *cond)
+{
+    ASSERT_NOTNULL(cond);
+
+    // << acquire lock <<
+
+    Proc *proc = _lock_unpark(&cond->waitQ);
+    if (proc) {
+        PDEBUG("COND signal\n");
+        _cond_move(cond, proc);
+    }
+
+    // >> release lock >>
+}
+
+void cond_broadcast(Cond *cond)
+{
+    ASSERT_NOTNULL(cond);
+
+    // << acquire lock <<
+
+    Proc *proc;
+    while ((proc = _lock_unpark(&cond->waitQ))) {
+        PDEBUG("COND broadcast\n");
+        _cond_move(cond, proc);
+    }
+
+    // >> release lock >>
+}
+
+/*
+ * Called when a PROC waiting on cond is cancelled. It is moved
+ * over to the mutex as if signaled, as it owns the mutex again
+ * when resumed.
+ */
+void cond_cancel(Cond *cond, Proc *proc)
+{
+    ASSERT_NOTNULL(cond);
+    ASSERT_NOTNULL(proc);
+
+    // << acquire lock <<
+
+    TAILQ_REMOVE(&cond->waitQ, proc, readyQ_next);
+    proc->wait_status = PROXC_ECANCEL;
+    _cond_move(cond, proc);
+
+    // >> release lock >>
+
+    PDEBUG("COND wait cancelled\n");
+}
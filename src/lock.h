@@ -0,0 +1,27 @@
+
+#ifndef LOCK_H__
+#define LOCK_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "internal.h"
+
+/* all waitQs are linked through readyQ_next of PROC */
+
+struct Mutex {
+    struct Proc   *owner;
+    struct ProcQ  waitQ;
+};
+
+struct Sem {
+    size_t        count;
+    struct ProcQ  waitQ;
+};
+
+struct Cond {
+    struct Mutex  *mtx;
+    struct ProcQ  waitQ;
+};
+
+#endif /* LOCK_H__ */
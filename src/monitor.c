@@ -0,0 +1,362 @@
+
+#include <stdlib.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "internal.h"
+
+int g_monitor_on = 0;
+
+/* the worker of each thread running a scheduler */
+static __thread Worker *t_worker = NULL;
+
+/*
+ * Monitored schedulers are checked every quarter threshold, and
+ * one found in the same PROC code since the threshold is retaken
+ * by the monitor and handed to an idle spare, or a new one.
+ */
+static struct {
+    pthread_mutex_t  lock;
+    pthread_cond_t   cond;
+
+    int       is_running;
+    uint64_t  threshold_us;
+
+    Scheduler  *scheds;
+    Worker     *idle;
+    size_t     num_spares;
+} g_mon = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .cond = PTHREAD_COND_INITIALIZER,
+    .is_running   = 0,
+    .threshold_us = 0,
+    .scheds       = NULL,
+    .idle         = NULL,
+    .num_spares   = 0
+};
+
+/* threads block all signals, which are left to the schedulers */
+static
+int _monitor_spawn(void *(*fxn)(void *), void *arg)
+{
+    sigset_t all, old;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+
+    pthread_t thread;
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    int ret = pthread_create(&thread, &attr, fxn, arg);
+    pthread_attr_destroy(&attr);
+
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    return ret;
+}
+
+static
+void _monitor_unlink(Scheduler *sched)
+{
+    Scheduler **link = &g_mon.scheds;
+    for (; *link; link = &(*link)->mon.next) {
+        if (*link == sched) {
+            *link = sched->mon.next;
+            break;
+        }
+    }
+    sched->mon.is_on = 0;
+}
+
+static
+void* _monitor_spare(void *data)
+{
+    Worker *spare = data;
+    t_worker = spare;
+
+    pthread_mutex_lock(&g_mon.lock);
+    for (;;) {
+        while (!spare->sched) {
+            pthread_cond_wait(&spare->cond, &g_mon.lock);
+        }
+        Scheduler *sched = spare->sched;
+        pthread_mutex_unlock(&g_mon.lock);
+
+        int is_done = scheduler_takeover(spare);
+
+        pthread_mutex_lock(&g_mon.lock);
+        if (is_done) {
+            /* the thread which started sched returns from it */
+            _monitor_unlink(sched);
+            sched->mon.is_done = 1;
+            pthread_cond_signal(&sched->mon.home.cond);
+        }
+        spare->sched   = NULL;
+        spare->is_lost = 0;
+        spare->next    = g_mon.idle;
+        g_mon.idle     = spare;
+    }
+    return NULL;
+}
+
+static
+Worker* _monitor_getspare(void)
+{
+    Worker *spare = g_mon.idle;
+    if (spare) {
+        g_mon.idle = spare->next;
+        return spare;
+    }
+    if (g_mon.num_spares == MAX_SPARE_THREADS) {
+        return NULL;
+    }
+
+    if (!(spare = calloc(1, sizeof(Worker)))) {
+        PERROR("calloc failed for Worker\n");
+        return NULL;
+    }
+    ctx_init(&spare->spare_ctx, NULL);
+    spare->ctx = &spare->spare_ctx;
+    pthread_cond_init(&spare->cond, NULL);
+    if (_monitor_spawn(_monitor_spare, spare)) {
+        PERROR("pthread_create failed for spare\n");
+        pthread_cond_destroy(&spare->cond);
+        free(spare);
+        return NULL;
+    }
+    ++g_mon.num_spares;
+    return spare;
+}
+
+/* whether other PROCs of sched could run, if it was not stuck */
+static
+int _monitor_haswork(Scheduler *sched)
+{
+    if (__atomic_load_n(&sched->readyQ.tqh_first, __ATOMIC_RELAXED)
+        || __atomic_load_n(&sched->sleep.num, __ATOMIC_RELAXED)
+        || __atomic_load_n(&sched->altsleep.num, __ATOMIC_RELAXED)
+        || __atomic_load_n(&sched->timers.num, __ATOMIC_RELAXED)
+        || __atomic_load_n(&sched->pool_done, __ATOMIC_RELAXED)
+        || __atomic_load_n(&sched->injectQ, __ATOMIC_RELAXED)) {
+        return 1;
+    }
+    Poller *poller = __atomic_load_n(&sched->poller, __ATOMIC_RELAXED);
+    return poller && __atomic_load_n(&poller->num_waits, __ATOMIC_RELAXED)
+                   > __atomic_load_n(&poller->num_sources, __ATOMIC_RELAXED);
+}
+
+static
+void _monitor_check(Scheduler *sched, uint64_t now_us)
+{
+    /* state is loaded first, as PROC code is left after the tick */
+    uint64_t state = __atomic_load_n(&sched->mon.state, __ATOMIC_ACQUIRE);
+    uint64_t tick  = __atomic_load_n(&sched->mon.tick, __ATOMIC_RELAXED);
+    if (!(state & 1) || tick != sched->mon.seen_tick) {
+        sched->mon.seen_tick = tick;
+        sched->mon.seen_us   = now_us;
+        return;
+    }
+    if (now_us - sched->mon.seen_us < g_mon.threshold_us || !_monitor_haswork(sched)) {
+        return;
+    }
+
+    Worker *spare = _monitor_getspare();
+    if (!spare) {
+        return;
+    }
+
+    /* stable while in PROC code, and seen by the lost thread after the CAS */
+    Worker *lost = sched->mon.worker;
+    lost->lost_proc = sched->curr_proc;
+
+    uint64_t gen = (state >> 1) + 1;
+    if (!__atomic_compare_exchange_n(&sched->mon.state, &state, gen << 1, 0,
+                                     __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+        /* the PROC entered the runtime meanwhile */
+        spare->next = g_mon.idle;
+        g_mon.idle  = spare;
+        return;
+    }
+
+    PDEBUG("MONITOR scheduler retaken\n");
+
+    spare->sched = sched;
+    spare->gen   = gen;
+    sched->mon.worker  = spare;
+    sched->mon.seen_us = now_us;
+    pthread_cond_signal(&spare->cond);
+}
+
+static
+void* _monitor_main(void *data)
+{
+    (void)data;
+
+    pthread_mutex_lock(&g_mon.lock);
+    for (;;) {
+        while (!g_mon.scheds) {
+            pthread_cond_wait(&g_mon.cond, &g_mon.lock);
+        }
+        uint64_t interval_us = g_mon.threshold_us / 4;
+        pthread_mutex_unlock(&g_mon.lock);
+
+        usleep((useconds_t)((interval_us > 0) ? interval_us : 1));
+
+        pthread_mutex_lock(&g_mon.lock);
+        uint64_t now_us = gettimestamp();
+        Scheduler *sched;
+        for (sched = g_mon.scheds; sched; sched = sched->mon.next) {
+            _monitor_check(sched, now_us);
+        }
+    }
+    return NULL;
+}
+
+/* called by the thread which starts sched, before its loop */
+void monitor_bind(Scheduler *sched, Worker *worker)
+{
+    ASSERT_NOTNULL(sched);
+    ASSERT_NOTNULL(worker);
+
+    worker->ctx       = &sched->ctx;
+    worker->sched     = sched;
+    worker->gen       = 0;
+    worker->lost_proc = NULL;
+    worker->is_lost   = 0;
+    worker->next      = NULL;
+    pthread_cond_init(&worker->cond, NULL);
+
+    sched->mon.worker = worker;
+    t_worker = worker;
+}
+
+/*
+ * Monitors sched, called from one of its PROCs. The threshold is
+ * shared by all monitored schedulers, and the last one set is used.
+ */
+int monitor_add(Scheduler *sched, uint64_t threshold_us)
+{
+    ASSERT_NOTNULL(sched);
+
+    /* the loop of an embedded scheduler cannot be handed over */
+    if (sched->is_embedded) {
+        return ENOTSUP;
+    }
+
+    /* lost threads wake the new one as they hand their PROC over */
+    int ret;
+    if ((ret = scheduler_initwake(sched))) {
+        return ret;
+    }
+
+    pthread_mutex_lock(&g_mon.lock);
+    if (!g_mon.is_running) {
+        if ((ret = _monitor_spawn(_monitor_main, NULL))) {
+            pthread_mutex_unlock(&g_mon.lock);
+            PERROR("pthread_create failed for monitor\n");
+            return ret;
+        }
+        g_mon.is_running = 1;
+    }
+    g_mon.threshold_us = threshold_us;
+
+    if (!sched->mon.is_on) {
+        __atomic_store_n(&sched->mon.state, t_worker->gen << 1, __ATOMIC_RELEASE);
+        sched->mon.seen_tick = sched->mon.tick;
+        sched->mon.seen_us   = gettimestamp();
+        sched->mon.is_on     = 1;
+        sched->mon.next      = g_mon.scheds;
+        g_mon.scheds = sched;
+        __atomic_store_n(&g_monitor_on, 1, __ATOMIC_RELEASE);
+        pthread_cond_signal(&g_mon.cond);
+    }
+    pthread_mutex_unlock(&g_mon.lock);
+
+    PDEBUG("MONITOR added scheduler\n");
+
+    return 0;
+}
+
+void monitor_remove(Scheduler *sched)
+{
+    ASSERT_NOTNULL(sched);
+
+    pthread_mutex_lock(&g_mon.lock);
+    if (sched->mon.is_on) {
+        _monitor_unlink(sched);
+    }
+    pthread_mutex_unlock(&g_mon.lock);
+    pthread_cond_destroy(&sched->mon.home.cond);
+}
+
+/* called by the thread which started sched after losing it */
+void monitor_wait(Scheduler *sched)
+{
+    ASSERT_NOTNULL(sched);
+
+    pthread_mutex_lock(&g_mon.lock);
+    while (!sched->mon.is_done) {
+        pthread_cond_wait(&sched->mon.home.cond, &g_mon.lock);
+    }
+    pthread_mutex_unlock(&g_mon.lock);
+    pthread_cond_destroy(&sched->mon.home.cond);
+}
+
+/*
+ * The PROC switches back to the loop of this thread, which hands
+ * it to the new owner, and resumes on the thread of that.
+ */
+static
+void _monitor_rejoin(Worker *worker)
+{
+    PDEBUG("MONITOR scheduler lost, rejoin\n");
+
+    worker->is_lost = 1;
+    ctx_switch(&worker->lost_proc->ctx, worker->ctx);
+}
+
+int _monitor_enter(int can_move)
+{
+    Worker *worker = t_worker;
+    if (!worker || !worker->sched->mon.is_on) {
+        return 0;
+    }
+
+    Scheduler *sched = worker->sched;
+    uint64_t state = (worker->gen << 1) | 1;
+    if (__atomic_compare_exchange_n(&sched->mon.state, &state, worker->gen << 1, 0,
+                                    __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)) {
+        return 1;
+    }
+    if ((state >> 1) == worker->gen || !can_move) {
+        /* already in the runtime, or left to the caller as lost */
+        return 0;
+    }
+
+    /* retaken, and from here on another thread */
+    _monitor_rejoin(worker);
+    return 1;
+}
+
+int _monitor_islost(void)
+{
+    Worker *worker = t_worker;
+    if (!worker || !worker->sched || !worker->sched->mon.is_on) {
+        return 0;
+    }
+    uint64_t state = __atomic_load_n(&worker->sched->mon.state, __ATOMIC_ACQUIRE);
+    return (state >> 1) != worker->gen;
+}
+
+void _monitor_leave(void)
+{
+    Worker *worker = t_worker;
+    if (!worker || !worker->sched->mon.is_on) {
+        return;
+    }
+
+    Scheduler *sched = worker->sched;
+    __atomic_store_n(&sched->mon.tick, sched->mon.tick + 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&sched->mon.state, (worker->gen << 1) | 1, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,82 @@
+
+#ifndef MONITOR_H__
+#define MONITOR_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "internal.h"
+
+/*
+ * A thread running a scheduler, either the one which started it
+ * or a spare which the monitor handed it to.
+ */
+struct Worker {
+    /* loop context, which PROCs yield to while this runs sched */
+    Ctx  *ctx;
+    Ctx  spare_ctx;
+
+    struct Scheduler  *sched;
+    /* generation of sched owned by this thread */
+    uint64_t  gen;
+
+    /* PROC running when sched was retaken, and set once this rejoins */
+    struct Proc  *lost_proc;
+    int  is_lost;
+
+    /* idle spares wait on cond for a scheduler, in a LIFO */
+    pthread_cond_t  cond;
+    struct Worker   *next;
+};
+
+/* set once any scheduler is monitored */
+extern int g_monitor_on;
+
+/*
+ * Called as PROC code enters the runtime, returns 1 if it left PROC
+ * code, to be passed to monitor_leave as it returns.
+ */
+static inline
+int monitor_enter(void)
+{
+    return UNLIKELY(g_monitor_on) ? _monitor_enter(1) : 0;
+}
+
+/*
+ * As monitor_enter, for calls which return errors in errno. These
+ * never move a PROC retaken from, as glibc declares the address of
+ * errno const, so PROC code may keep that of this thread across the
+ * call. The call then runs as a plain blocking one on this thread,
+ * which runs no other PROC, and the PROC moves at its next call.
+ */
+static inline
+int monitor_enterhere(void)
+{
+    return UNLIKELY(g_monitor_on) ? _monitor_enter(0) : 0;
+}
+
+/* whether PROC code on this thread was retaken from, and not moved */
+static inline
+int monitor_islost(void)
+{
+    return UNLIKELY(g_monitor_on) ? _monitor_islost() : 0;
+}
+
+static inline
+void monitor_leave(int *is_entered)
+{
+    if (UNLIKELY(*is_entered)) {
+        _monitor_leave();
+    }
+}
+
+/* guards the rest of the scope as runtime, which is never retaken */
+#define MONITOR_GATE() \
+    int _monitor_entered __attribute__((cleanup(monitor_leave), unused)) = monitor_enter()
+
+/* as MONITOR_GATE, for calls which return errors in errno */
+#define MONITOR_GATE_ERRNO() \
+    int _monitor_entered __attribute__((cleanup(monitor_leave), unused)) = monitor_enterhere()
+
+#endif /* MONITOR_H__ */
@@ -0,0 +1,183 @@
+
+#include <stdlib.h>
+#include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+
+#include "internal.h"
+
+/*
+ * Threads are shared by all schedulers, and created on demand
+ * until MAX_POOL_THREADS, after which calls are queued.
+ */
+static struct {
+    pthread_mutex_t  lock;
+    pthread_cond_t   cond;
+
+    PoolJob  *head;
+    PoolJob  *tail;
+
+    size_t  num_threads;
+    size_t  num_idle;
+} g_pool = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .cond = PTHREAD_COND_INITIALIZER,
+    .head = NULL,
+    .tail = NULL,
+    .num_threads = 0,
+    .num_idle    = 0
+};
+
+/*
+ * Pushes job to the done LIFO of the scheduler of its PROC, and
+ * the first push after a drain wakes the scheduler.
+ */
+static
+void _pool_done(PoolJob *job)
+{
+    Scheduler *sched = job->proc->sched;
+
+    /* the scheduler is not freed while this refers to it */
+    __atomic_add_fetch(&sched->wake_refs, 1, __ATOMIC_ACQ_REL);
+
+    PoolJob *head = __atomic_load_n(&sched->pool_done, __ATOMIC_RELAXED);
+    do {
+        job->next = head;
+    } while (!__atomic_compare_exchange_n(&sched->pool_done, &head, job, 1,
+                                          __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+    if (!head) {
+        scheduler_notify(sched);
+    }
+
+    __atomic_sub_fetch(&sched->wake_refs, 1, __ATOMIC_RELEASE);
+}
+
+static
+void* _pool_main(void *data)
+{
+    (void)data;
+
+    pthread_mutex_lock(&g_pool.lock);
+    for (;;) {
+        while (!g_pool.head) {
+            ++g_pool.num_idle;
+            pthread_cond_wait(&g_pool.cond, &g_pool.lock);
+            --g_pool.num_idle;
+        }
+        PoolJob *job = g_pool.head;
+        g_pool.head = job->next;
+        if (!g_pool.head) {
+            g_pool.tail = NULL;
+        }
+        pthread_mutex_unlock(&g_pool.lock);
+
+        job->result = job->fxn(job->arg);
+        _pool_done(job);
+
+        pthread_mutex_lock(&g_pool.lock);
+    }
+    return NULL;
+}
+
+/* threads block all signals, which are left to the schedulers */
+static
+int _pool_spawn(void)
+{
+    sigset_t all, old;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+
+    pthread_t thread;
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    int ret = pthread_create(&thread, &attr, _pool_main, NULL);
+    pthread_attr_destroy(&attr);
+
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    return ret;
+}
+
+static
+int _pool_submit(PoolJob *job)
+{
+    pthread_mutex_lock(&g_pool.lock);
+
+    if (g_pool.num_idle == 0 && g_pool.num_threads < MAX_POOL_THREADS) {
+        if (_pool_spawn() == 0) {
+            ++g_pool.num_threads;
+        }
+        else if (g_pool.num_threads == 0) {
+            pthread_mutex_unlock(&g_pool.lock);
+            PERROR("pthread_create failed for pool\n");
+            return EAGAIN;
+        }
+    }
+
+    job->next = NULL;
+    if (g_pool.tail) {
+        g_pool.tail->next = job;
+    }
+    else {
+        g_pool.head = job;
+    }
+    g_pool.tail = job;
+    pthread_cond_signal(&g_pool.cond);
+
+    pthread_mutex_unlock(&g_pool.lock);
+    return 0;
+}
+
+/*
+ * Runs fxn(arg) on a thread of the pool, while the PROC is parked
+ * and the other PROCs of the scheduler keep running, and returns
+ * its result. If no thread can be had, fxn is called directly.
+ * The call is not interrupted when the PROC is cancelled.
+ */
+void* pool_call(void *(*fxn)(void *), void *arg)
+{
+    ASSERT_NOTNULL(fxn);
+
+    Proc *proc = proc_self();
+    if (scheduler_initwake(proc->sched)) {
+        return fxn(arg);
+    }
+
+    struct PoolJob job = {
+        .fxn    = fxn,
+        .arg    = arg,
+        .result = NULL,
+        .proc   = proc,
+        .next   = NULL
+    };
+    if (_pool_submit(&job)) {
+        return fxn(arg);
+    }
+
+    PDEBUG("POOL call submitted, park\n");
+
+    /* yield until the scheduler drains the job as done */
+    proc->state = PROC_POOLWAIT;
+    proc_yield(proc);
+    return job.result;
+}
+
+/*
+ * Called by the scheduler, readies the PROCs of all jobs done
+ * since the last drain, in the order they were done.
+ */
+void pool_drain(Scheduler *sched)
+{
+    PoolJob *job = __atomic_exchange_n(&sched->pool_done, NULL, __ATOMIC_ACQUIRE);
+
+    PoolJob *prev = NULL, *next;
+    for (; job; job = next) {
+        next = job->next;
+        job->next = prev;
+        prev = job;
+    }
+    for (job = prev; job; job = next) {
+        next = job->next;
+        scheduler_addready(job->proc);
+    }
+}
@@ -0,0 +1,22 @@
+
+#ifndef POOL_H__
+#define POOL_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "internal.h"
+
+/* a blocking call of a PROC, run by a thread of the pool */
+struct PoolJob {
+    void  *(*fxn)(void *arg);
+    void  *arg;
+    void  *result;
+
+    struct Proc  *proc;
+
+    /* in the queue of the pool, and then the done LIFO of the scheduler */
+    struct PoolJob  *next;
+};
+
+#endif /* POOL_H__ */
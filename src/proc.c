@@ -20,7 +20,10 @@ void proc_mainfxn(Proc *proc)
         /* remove context from scheduler */
         /* return control to scheduler */
 
+    /* fxn is PROC code, which a monitor may retake the scheduler in */
+    if (UNLIKELY(g_monitor_on)) _monitor_leave();
     proc->fxn();
+    monitor_enter();
 
     PDEBUG("proc_mainfxn done\n");
 
@@ -35,48 +38,98 @@ Proc* proc_self(void)
     return proc;
 }
 
-int proc_create(Proc **new_proc, ProcFxn fxn)
+static
+void _proc_init(Proc *proc, Scheduler *sched, ProcFxn fxn)
 {
-    ASSERT_NOTNULL(new_proc);
-    ASSERT_NOTNULL(fxn);
-
-    Proc *proc;
-    if (!(proc = malloc(sizeof(Proc)))) {
-        PERROR("malloc failed for Proc\n");
-        return errno;
-    }
-
-    Scheduler *sched = scheduler_self();
-    if (posix_memalign(&proc->stack.ptr, sched->page_size, sched->stack_size)) {
-        free(proc);
-        PERROR("posix_memalign failed\n");
-        return errno;
-    }
-
     /* set fxn and args */
     proc->fxn      = fxn;
-    proc->args.num = 0;
-    proc->args.ptr = NULL;
+    proc->args.num  = 0;
+    proc->args.size = 0;
+    proc->args.ptr  = NULL;
 
     /* configure members */
     proc->stack.size = sched->stack_size;
     proc->stack.used = 0;
+    proc->stack.reserved = 0;
     proc->state      = PROC_READY;
     proc->sleep_us   = 0;
+    proc->ch_end     = NULL;
+    proc->alt        = NULL;
+    proc->io_wait    = NULL;
+    proc->call_end   = NULL;
+    proc->wait_obj   = NULL;
+    proc->wait_status = 0;
+    proc->alt_poisoned = -1;
+    proc->is_cancelled = 0;
+    proc->run_build  = NULL;
+    proc->run_status = 0;
     proc->sched      = sched;
     proc->proc_build = NULL;
-
-    /* configure context */
-    ctx_init(&proc->ctx, proc);
+    proc->is_bulk    = 0;
+    proc->is_tmpl    = 0;
+    proc->args.tmpl  = NULL;
 
     /* register in sched totalQ */
     TAILQ_INSERT_TAIL(&sched->totalQ, proc, schedQ_node);
+}
+
+int proc_create(Proc **new_proc, ProcFxn fxn)
+{
+    ASSERT_NOTNULL(new_proc);
+    ASSERT_NOTNULL(fxn);
+
+    Proc *proc;
+    if (!(proc = malloc(sizeof(Proc)))) {
+        PERROR("malloc failed for Proc\n");
+        return errno;
+    }
+
+    /* stack is not set up until the PROC is scheduled */
+    proc->stack.ptr = NULL;
+    _proc_init(proc, scheduler_self(), fxn);
 
     *new_proc = proc;
 
     return 0;
 }
 
+/*
+ * Creates num PROCs with one allocation for all PROC structs,
+ * which is freed by the owner with proc_freebulk, and not by
+ * proc_free. Stacks are taken as each PROC is scheduled.
+ */
+int proc_createbulk(Proc **new_procs, size_t num, ProcFxn fxn)
+{
+    ASSERT_NOTNULL(new_procs);
+    ASSERT_NOTNULL(fxn);
+    ASSERT_TRUE(num > 0);
+
+    Proc *procs;
+    if (!(procs = malloc(sizeof(Proc) * num))) {
+        PERROR("malloc failed for Procs\n");
+        return errno;
+    }
+
+    Scheduler *sched = scheduler_self();
+    for (size_t i = 0; i < num; ++i) {
+        Proc *proc = &procs[i];
+        proc->stack.ptr = NULL;
+        _proc_init(proc, sched, fxn);
+        proc->is_bulk = 1;
+    }
+
+    *new_procs = procs;
+
+    return 0;
+}
+
+void proc_freebulk(Proc *procs)
+{
+    if (!procs) return;
+
+    free(procs);
+}
+
 void proc_free(Proc *proc)
 {
     if (!proc) return;
@@ -85,61 +138,318 @@ void proc_free(Proc *proc)
     Scheduler *sched = proc->sched;
     TAILQ_REMOVE(&sched->totalQ, proc, schedQ_node);
 
-    /* resolve ProcBuild */
     ProcBuild *build = proc->proc_build;
+
+    /* template PROCs are kept for the next run, and only */
+    /* give back a stack which their args are not stored on */
+    if (proc->is_tmpl) {
+        if (proc->stack.reserved == 0) {
+            scheduler_putstack(sched, proc->stack.ptr);
+            proc->stack.ptr = NULL;
+        }
+    }
+    /* bulk PROCs are freed together with their builder */
+    else if (proc->is_bulk) {
+        scheduler_putstack(sched, proc->stack.ptr);
+        proc->stack.ptr = NULL;
+    }
+    else {
+        proc_release(proc);
+    }
+
+    /* resolve ProcBuild, this is done last as it */
+    /* may free the PROC if allocated in bulk */
     if (build != NULL) {
         csp_parsebuild(BUILDER_CAST(build, Builder*));
     }
+}
 
-    free(proc->args.ptr);
-    free(proc->stack.ptr);
+/*
+ * Frees a PROC which is not registered in the scheduler, and
+ * puts back its stack for the next PROC to run.
+ */
+void proc_release(Proc *proc)
+{
+    if (!proc) return;
+
+    scheduler_putstack(proc->sched, proc->stack.ptr);
     free(proc);
 }
 
-static inline
-int _proc_copyargs(Proc *proc, void **buf, size_t buf_size)
+/*
+ * Readies a template PROC to run again, as if newly created.
+ */
+void proc_reset(Proc *proc)
 {
-    size_t new_num = proc->args.num + buf_size;
-    void *ptr;
-    if (!(ptr = realloc(proc->args.ptr, sizeof(void *) * new_num))) {
-        free(proc);
-        PERROR("realloc failed for Proc Args\n");
-        return errno;
+    ASSERT_NOTNULL(proc);
+    ASSERT_TRUE(proc->is_tmpl);
+
+    proc->state    = PROC_READY;
+    proc->sleep_us = 0;
+    proc->ch_end   = NULL;
+    proc->alt      = NULL;
+    proc->is_cancelled = 0;
+
+    TAILQ_INSERT_TAIL(&proc->sched->totalQ, proc, schedQ_node);
+}
+
+/*
+ * Sets up stack and context of a PROC about to be scheduled. A SEQ
+ * child is prepared after the previous child is freed, and thus
+ * gets the same stack back from the scheduler. Bulk PROCs are only
+ * prepared as they are first resumed, so a replicated PAR whose
+ * childs do not block needs no more stacks than one.
+ */
+int proc_prepare(Proc *proc)
+{
+    ASSERT_NOTNULL(proc);
+
+    /* stack is set up front for args on stack */
+    if (!proc->stack.ptr) {
+        if (!(proc->stack.ptr = scheduler_getstack(proc->sched))) {
+            return errno;
+        }
+        proc->stack.used = 0;
     }
-    proc->args.ptr = ptr;
-    memcpy(proc->args.ptr + proc->args.num, buf, sizeof(void *) * buf_size);
-    proc->args.num += buf_size;
+    ctx_init(&proc->ctx, proc);
+
     return 0;
 }
 
+/*
+ * Returns storage for size bytes of args. Args are stored inline
+ * in the PROC if they fit, else on top of the stack, in which
+ * case the context is started below them when prepared.
+ */
+static
+void* _proc_argstorage(Proc *proc, size_t size)
+{
+    ASSERT_EQ(proc->args.size, 0);
+
+    if (size <= sizeof(proc->args.inl)) {
+        return proc->args.inl;
+    }
+
+    size_t reserved = (size + 15) & ~(size_t)15;
+    if (UNLIKELY(reserved > proc->stack.size / 2)) {
+        PANIC("Proc args of size %zu do not fit on stack\n", size);
+    }
+    /* args on stack require the stack up front */
+    if (!proc->stack.ptr && !(proc->stack.ptr = scheduler_getstack(proc->sched))) {
+        PANIC("Proc stack for args could not be allocated\n");
+    }
+    proc->stack.reserved = reserved;
+
+    return (char *)proc->stack.ptr + proc->stack.size - reserved;
+}
+
 int proc_setargs(Proc *proc, va_list args)
 {
-    enum { ARGS_N = 32 };
-    void *tmp_args[ARGS_N];
-    size_t curr_n = 0;
-    int ret;
-
-    void *xarg = va_arg(args, void *);
-    while (xarg != PROXC_NULL) {
-        tmp_args[curr_n++] = xarg;
-        xarg = va_arg(args, void *);
-
-        /* if tmp_args is full, realloc and copy over into args */
-        if (curr_n == ARGS_N) {
-            ret = _proc_copyargs(proc, tmp_args, ARGS_N);
-            ASSERT_0(ret);
-            curr_n = 0;
-        }
-    } 
+    ASSERT_NOTNULL(proc);
+
+    /* count args first, to store them without realloc */
+    size_t num = 0;
+    va_list count;
+    va_copy(count, args);
+    while (va_arg(count, void *) != PROXC_NULL) {
+        num++;
+    }
+    va_end(count);
+
+    if (num == 0) return 0;
 
-    if (curr_n > 0) {
-        ret = _proc_copyargs(proc, tmp_args, curr_n);
-        ASSERT_0(ret);
+    void **ptr = _proc_argstorage(proc, sizeof(void *) * num);
+    for (size_t i = 0; i < num; i++) {
+        ptr[i] = va_arg(args, void *);
     }
 
+    proc->args.ptr  = ptr;
+    proc->args.num  = num;
+    proc->args.size = sizeof(void *) * num;
+
     return 0;
 }
 
+void proc_setarg(Proc *proc, void *arg)
+{
+    ASSERT_NOTNULL(proc);
+    ASSERT_EQ(proc->args.num, 0);
+
+    void **ptr = (void **)proc->args.inl;
+    ptr[0] = arg;
+    proc->args.ptr  = ptr;
+    proc->args.num  = 1;
+    proc->args.size = sizeof(void *);
+}
+
+/*
+ * Copies size bytes from blob into the args of proc, which is
+ * accessed by value through proxc_args() when running.
+ */
+void proc_setblob(Proc *proc, const void *blob, size_t size)
+{
+    ASSERT_NOTNULL(proc);
+
+    if (size == 0) return;
+
+    void *ptr = _proc_argstorage(proc, size);
+    memcpy(ptr, blob, size);
+
+    proc->args.ptr  = ptr;
+    proc->args.num  = 0;
+    proc->args.size = size;
+}
+
+/*
+ * An inline PROC runs on what is left of the stack of proc, so
+ * it is only done if at most MAX_INLINE_USED of it is in use,
+ * args reserved at the top included.
+ */
+int proc_caninline(Proc *proc)
+{
+    ASSERT_NOTNULL(proc);
+
+    char *sp = __builtin_frame_address(0);
+    size_t unused = (size_t)(sp - (char *)proc->stack.ptr);
+    return proc->stack.size - unused <= MAX_INLINE_USED;
+}
+
+/*
+ * Runs fxn of child directly on the stack of proc, with the args
+ * and build of child swapped in. If child blocks, proc is parked in its
+ * place. When done, child is resolved as if it ended on its own,
+ * and proc waits for the rest of the RUN tree, if any.
+ */
+void proc_runinline(Proc *proc, Proc *child)
+{
+    ASSERT_NOTNULL(proc);
+    ASSERT_NOTNULL(child);
+
+    PDEBUG("PROC run inline\n");
+
+    __typeof__(proc->args) args = proc->args;
+    ProcBuild *build = proc->proc_build;
+    proc->args = child->args;
+    proc->proc_build = child->proc_build;
+    if (UNLIKELY(g_monitor_on)) _monitor_leave();
+    child->fxn();
+    monitor_enter();
+    proc->args = args;
+    proc->proc_build = build;
+
+    /* resolving child reschedules proc if the tree is done */
+    proc->state = PROC_RUNWAIT;
+    proc_free(child);
+    if (proc->state == PROC_READY) {
+        scheduler_remready(proc);
+        proc->state = PROC_RUNNING;
+        return;
+    }
+    proc_yield(proc);
+}
+
+/*
+ * Marks proc as cancelled, and wakes it with PROXC_ECANCEL if it
+ * waits on a chan, an ALT, a SLEEP, a CALL, a barrier, a lock or
+ * a future. I/O on the io_uring and the thread pool is not
+ * interrupted, but every later wait of proc fails. A RUN in
+ * progress in proc is cancelled along with it.
+ */
+void proc_cancel(Proc *proc)
+{
+    ASSERT_NOTNULL(proc);
+
+    if (proc->is_cancelled) return;
+
+    PDEBUG("PROC cancelled\n");
+    proc->is_cancelled = 1;
+
+    if (proc->run_build) {
+        csp_cancelbuild(proc->run_build);
+    }
+
+    switch (proc->state) {
+    case PROC_CHANWAIT:
+        chan_cancel(proc->ch_end);
+        break;
+    case PROC_ALTWAIT:
+        alt_cancel(proc->alt);
+        break;
+    case PROC_IOWAIT:
+        io_cancel(proc->io_wait);
+        break;
+    case PROC_SLEEPING:
+        scheduler_remsleep(proc);
+        scheduler_addready(proc);
+        break;
+    case PROC_CALLWAIT:
+        call_cancel(proc->call_end);
+        break;
+    case PROC_BARWAIT:
+        barrier_cancel(proc->wait_obj, proc);
+        break;
+    case PROC_LOCKWAIT:
+        mutex_cancel(proc->wait_obj, proc);
+        break;
+    case PROC_SEMWAIT:
+        semaphore_cancel(proc->wait_obj, proc);
+        break;
+    case PROC_CONDWAIT:
+        /* not when signaled, and waiting on the mutex */
+        if (proc->wait_obj) {
+            cond_cancel(proc->wait_obj, proc);
+        }
+        break;
+    case PROC_FUTWAIT:
+        future_cancel(proc->wait_obj, proc);
+        break;
+    default:
+        /* running, ready or in a wait not interrupted */
+        break;
+    }
+}
+
+/*
+ * Returns 1 if proc is cancelled, and should not wait. It yields
+ * first, so a PROC which ignores the error does not starve the
+ * others.
+ */
+int proc_cancelpoint(Proc *proc)
+{
+    if (LIKELY(!proc->is_cancelled)) {
+        return 0;
+    }
+    proc_yield(proc);
+    return 1;
+}
+
+/*
+ * Parks proc for usec, or yields if 0, unless it is cancelled.
+ */
+void proc_sleep(Proc *proc, uint64_t usec)
+{
+    proc_sleepuntil(proc, (usec > 0) ? gettimestamp() + usec : 0);
+}
+
+/*
+ * Sleeps until deadline_us, a timestamp of gettimestamp, and only
+ * yields if it is 0. A deadline passed wakes at the next round.
+ */
+void proc_sleepuntil(Proc *proc, uint64_t deadline_us)
+{
+    ASSERT_NOTNULL(proc);
+
+    if (UNLIKELY(proc_cancelpoint(proc))) {
+        return;
+    }
+    if (deadline_us > 0) {
+        proc->sleep_us = deadline_us;
+        scheduler_addsleep(proc);
+    }
+    proc_yield(proc);
+    proc->sleep_us = 0;
+}
+
 void proc_yield(Proc *proc)
 {
     Scheduler *sched = (!proc)
@@ -147,6 +457,6 @@ void proc_yield(Proc *proc)
                      : proc->sched;
 
     PDEBUG("yielding\n");
-    ctx_switch(&sched->curr_proc->ctx, &sched->ctx);
+    ctx_switch(&sched->curr_proc->ctx, sched->loop_ctx);
 }
 
@@ -7,6 +7,9 @@
 
 #include "internal.h"
 
+/* bytes of args stored inline in the PROC struct */
+#define PROC_ARGS_INLINE  64
+
 enum ProcState {
     PROC_ERROR = 0,
     PROC_READY,
@@ -16,7 +19,16 @@ enum ProcState {
     PROC_CHANWAIT,
     PROC_RUNWAIT,
     PROC_ALTWAIT,
-    PROC_ALTSLEEP
+    PROC_ALTSLEEP,
+    PROC_CALLWAIT,
+    PROC_BARWAIT,
+    PROC_LOCKWAIT,
+    PROC_SEMWAIT,
+    PROC_CONDWAIT,
+    PROC_FUTWAIT,
+    PROC_IOWAIT,
+    PROC_URINGWAIT,
+    PROC_POOLWAIT
 };
 
 struct Proc {
@@ -28,27 +40,58 @@ struct Proc {
     ProcFxn  fxn;
     struct {
         size_t  num;
-        void    **ptr;
+        size_t  size;
+        void    *ptr;
+        /* storage for small args, larger are put on top of stack */
+        unsigned char  inl[PROC_ARGS_INLINE] __attribute__((aligned(16)));
+        /* template run this PROC is part of, if any */
+        struct Template  *tmpl;
     } args;
 
-    /* stack and size */
+    /* stack and size, reserved is taken from top by args */
     struct {
         size_t  size;
         size_t  used;
+        size_t  reserved;
         void    *ptr;
     } stack;
     
     uint64_t  sleep_us;
 
+    /* end of a waiting chan operation, a waiting ALT and I/O */
+    struct ChanEnd  *ch_end;
+    struct Alt      *alt;
+    struct IoWait   *io_wait;
+
+    /* end of a waiting CALL, and the barrier, lock or future */
+    /* whose waitQ the PROC is parked in, with the wait status */
+    struct CallEnd  *call_end;
+    void            *wait_obj;
+    int             wait_status;
+
+    /* key of the guard whose chan was poisoned, in the last */
+    /* ALT which returned PROXC_EPOISON */
+    int  alt_poisoned;
+
+    /* set when the tree of this PROC is cancelled */
+    int  is_cancelled;
+
+    /* tree of a RUN in progress, and its result */
+    struct Builder  *run_build;
+    int  run_status;
+
     /* scheduler related */
     struct Scheduler   *sched;
     TAILQ_ENTRY(Proc)  schedQ_node;
     TAILQ_ENTRY(Proc)  readyQ_next;
     TAILQ_ENTRY(Proc)  altQ_next;
     RB_ENTRY(Proc)     sleepRB_node;
+    struct Proc        *remote_next;
 
     /* Par/Seq/Proc-builder related */
     struct ProcBuild  *proc_build;
+    int  is_bulk;
+    int  is_tmpl;
 };
 
 #endif /* PROC_H__ */
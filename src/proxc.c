@@ -14,6 +14,7 @@ void proxc_start(ProcFxn fxn)
     scheduler_create(&sched);
     Proc *proc;
     proc_create(&proc, fxn);
+    proc_prepare(proc);
     proc->sched->main_proc = proc;
     scheduler_addready(proc);
 
@@ -22,8 +23,73 @@ void proxc_start(ProcFxn fxn)
     scheduler_free(sched);
 }
 
+/*
+ * Creates a scheduler for the calling thread, which a loop of the
+ * caller then drives with proxc_poll, instead of proxc_start.
+ * PROCs are started on it with SPAWN or GO.
+ */
+int proxc_init(void)
+{
+    if (scheduler_current()) {
+        return EEXIST;
+    }
+
+    int ret;
+    Scheduler *sched;
+    if ((ret = scheduler_create(&sched))) {
+        return ret;
+    }
+    sched->is_embedded = 1;
+    monitor_bind(sched, &sched->mon.home);
+    if (!scheduler_initwake(sched)) {
+        inject_register(sched);
+    }
+    return 0;
+}
+
+/* frees the scheduler of proxc_init, along with PROCs left on it */
+void proxc_fini(void)
+{
+    Scheduler *sched = scheduler_current();
+    if (!sched || !sched->is_embedded) return;
+
+    monitor_remove(sched);
+    scheduler_free(sched);
+}
+
+/*
+ * Runs the ready PROCs of the scheduler of proxc_init, until none
+ * is ready or usec has passed. Returns 1 while PROCs remain, and 0
+ * once all have ended, or one called EXIT.
+ */
+int proxc_poll(uint64_t usec)
+{
+    return scheduler_poll(scheduler_self(), usec);
+}
+
+/*
+ * Returns the usec until proxc_poll is next due, 0 if now, and -1
+ * if only when the fd of proxc_fd becomes readable.
+ */
+int64_t proxc_next_deadline(void)
+{
+    return scheduler_nexttimeout(scheduler_self());
+}
+
+/*
+ * Returns the epoll fd of the scheduler, which is readable when
+ * PROCs waiting on I/O, or on other threads, can be resumed. The
+ * loop of the caller waits on it along with its own fds.
+ */
+int proxc_fd(void)
+{
+    Poller *poller = io_poller(scheduler_self());
+    return poller ? poller->epfd : -1;
+}
+
 void proxc_exit(void)
 {
+    MONITOR_GATE();
     Scheduler *sched = scheduler_self();
     sched->is_exit = 1;
     proc_yield(sched->curr_proc);
@@ -31,27 +97,66 @@ void proxc_exit(void)
 
 void* proxc_argn(size_t n)
 {
+    MONITOR_GATE();
     Proc *proc = proc_self();
     /* if n is index out of range, return NULL */
     return (n < proc->args.num) 
-        ? proc->args.ptr[n]
+        ? ((void **)proc->args.ptr)[n]
         : NULL;
 }
 
+void* proxc_args(void)
+{
+    MONITOR_GATE();
+    return proc_self()->args.ptr;
+}
+
 void proxc_yield(void)
 {
+    MONITOR_GATE();
     proc_yield(NULL);
 }
 
 void proxc_sleep(uint64_t usec)
 {
-    Proc *proc = proc_self();
-    if (usec > 0) {
-        proc->sleep_us = gettimestamp() + usec;
-        scheduler_addsleep(proc);
+    MONITOR_GATE();
+    proc_sleep(proc_self(), usec);
+}
+
+/*
+ * Sleeps until deadline, a timestamp as read by proxc_timer, so a
+ * loop adding its period to the deadline does not drift.
+ */
+void proxc_sleep_until(uint64_t deadline)
+{
+    MONITOR_GATE();
+    proc_sleepuntil(proc_self(), deadline);
+}
+
+/* reads the clock of timeouts and deadlines, in usec */
+uint64_t proxc_timer(void)
+{
+    return gettimestamp();
+}
+
+static
+Builder* _proxc_procbuild(Proc *proc)
+{
+    /* alloc builder struct */
+    ProcBuild *builder;
+    if (!(builder = csp_create(PROC_BUILD))) {
+        PERROR("malloc failed for ProcBuild\n");
+        proc_free(proc);
+        return NULL;
     }
-    proc_yield(proc);
-    proc->sleep_us = 0;
+
+    /* set builder members */
+    builder->proc = proc;
+
+    /* and ready scheduler for build */
+    proc->proc_build = builder;
+
+    return BUILDER_CAST(builder, Builder*);
 }
 
 /*
@@ -61,6 +166,7 @@ void proxc_sleep(uint64_t usec)
  */
 Builder* proxc_proc(ProcFxn fxn, ...)
 {
+    MONITOR_GATE();
     ASSERT_NOTNULL(fxn);
 
     PDEBUG("PROC build\n");
@@ -71,14 +177,6 @@ Builder* proxc_proc(ProcFxn fxn, ...)
     ret = proc_create(&proc, fxn);
     ASSERT_0(ret);
 
-    /* alloc builder struct */
-    ProcBuild *builder;
-    if (!(builder = csp_create(PROC_BUILD))) {
-        PERROR("malloc failed for ProcBuild\n");
-        proc_free(proc);
-        return NULL;
-    }
-
     /* set args list for fxn */
     va_list args;
     va_start(args, fxn);
@@ -86,14 +184,29 @@ Builder* proxc_proc(ProcFxn fxn, ...)
     ASSERT_0(ret);
     va_end(args);
 
-    /* set builder members */
-    builder->proc = proc;
+    return _proxc_procbuild(proc);
+} 
 
-    /* and ready scheduler for build */
-    proc->proc_build = builder;
+/*
+ * The size bytes of args are copied by value into the PROC,
+ * and accessed through proxc_args() method in fxn context.
+ */
+Builder* proxc_procargs(ProcFxn fxn, const void *args, size_t size)
+{
+    MONITOR_GATE();
+    ASSERT_NOTNULL(fxn);
 
-    return BUILDER_CAST(builder, Builder*);
-} 
+    PDEBUG("PROC build with %zu bytes of args\n", size);
+
+    int ret;
+    Proc *proc;
+    ret = proc_create(&proc, fxn);
+    ASSERT_0(ret);
+
+    proc_setblob(proc, args, size);
+
+    return _proxc_procbuild(proc);
+}
 
 
 /*
@@ -103,6 +216,7 @@ Builder* proxc_proc(ProcFxn fxn, ...)
  */
 Builder* proxc_par(int args_start, ...) 
 {
+    MONITOR_GATE();
 
     /* alloc builder struct */
     ParBuild *builder;
@@ -113,6 +227,7 @@ Builder* proxc_par(int args_start, ...)
     
     /* set builder members */
     builder->num_childs = 0;
+    builder->bulk_procs = NULL;
     TAILQ_INIT(&builder->childQ);
 
     /* parse args and insert them into builderQ */
@@ -130,6 +245,51 @@ Builder* proxc_par(int args_start, ...)
     return BUILDER_CAST(builder, Builder*);
 }
 
+/*
+ * Replicated PAR, as PAR i = 0 FOR num in occam. Child i runs
+ * fxn with (char *)args + i * stride as proxc_argn(0). 
+ */
+Builder* proxc_par_n(size_t num, ProcFxn fxn, void *args, size_t stride)
+{
+    MONITOR_GATE();
+    ASSERT_NOTNULL(fxn);
+    ASSERT_TRUE(num > 0);
+
+    /* alloc builder struct, and childs */
+    ParBuild *builder;
+    if (!(builder = csp_createparn(num))) {
+        PERROR("malloc failed for ParBuild\n");
+        return NULL;
+    }
+
+    /* alloc procs, stacks are taken when run */
+    Proc *procs;
+    if (proc_createbulk(&procs, num, fxn)) {
+        csp_free(BUILDER_CAST(builder, Builder*));
+        return NULL;
+    }
+
+    /* set builder members */
+    builder->num_childs = num;
+    builder->bulk_procs = procs;
+    TAILQ_INIT(&builder->childQ);
+
+    ProcBuild *childs = (ProcBuild *)(builder + 1);
+    for (size_t i = 0; i < num; ++i) {
+        ProcBuild *child = &childs[i];
+        Proc *proc = &procs[i];
+        proc_setarg(proc, (char *)args + i * stride);
+
+        child->proc = proc;
+        child->header.parent = BUILDER_CAST(builder, Builder*);
+        TAILQ_INSERT_TAIL(&builder->childQ, BUILDER_CAST(child, Builder*), header.node);
+        proc->proc_build = child;
+    }
+    PDEBUG("PAR_N build, %zu childs\n", num);
+
+    return BUILDER_CAST(builder, Builder*);
+}
+
 /*
  * Variadic args is a PROXC_NULL terminated list
  * of pointers to allready allocated PROCS.
@@ -137,6 +297,7 @@ Builder* proxc_par(int args_start, ...)
  */
 Builder* proxc_seq(int arg_start, ...)
 {
+    MONITOR_GATE();
 
     /* alloc builder struct */
     SeqBuild *builder;
@@ -167,6 +328,7 @@ Builder* proxc_seq(int arg_start, ...)
 
 int proxc_go(Builder *root)
 {
+    MONITOR_GATE();
     ASSERT_NOTNULL(root);
 
     Builder *build = BUILDER_CAST(root, Builder*);
@@ -180,33 +342,267 @@ int proxc_go(Builder *root)
     return 0;
 }
 
-int proxc_run(Builder *root)
+/*
+ * GO which returns a FUTURE, that is done when the tree of root
+ * is done, and holds a result of size bytes, set by any PROC in
+ * the tree through proxc_result().
+ */
+Future* proxc_gofuture(Builder *root, size_t size)
 {
+    MONITOR_GATE();
     ASSERT_NOTNULL(root);
 
-    Builder *build = BUILDER_CAST(root, Builder*); 
+    Future *fut;
+    if (!(fut = future_create(size))) {
+        return NULL;
+    }
+
+    Builder *build = BUILDER_CAST(root, Builder*);
+    build->header.future = fut;
+    fut->root = build;
+
+    proxc_go(root);
+
+    return fut;
+}
+
+void proxc_futfree(Future *fut)
+{
+    MONITOR_GATE();
+    future_free(fut);
+}
+
+/*
+ * Sets the result of the FUTURE of the tree this PROC is part of,
+ * also from a tree RUN within it. Returns 0 if there is no such
+ * FUTURE, else 1.
+ */
+int proxc_result(const void *data, size_t size)
+{
+    MONITOR_GATE();
+    Proc *proc = proc_self();
+    Future *fut = csp_future(BUILDER_CAST(proc->proc_build, Builder*));
+    if (!fut) {
+        return 0;
+    }
+    future_setresult(fut, data, size);
+    return 1;
+}
+
+int proxc_await(Future *fut, void *out, size_t size)
+{
+    MONITOR_GATE();
+    return future_await(fut, out, size);
+}
+
+/*
+ * Cancels the tree of fut, if not done. Its PROCs waiting on a
+ * chan, ALT, SLEEP, CALL, barrier, lock or future are woken with
+ * PROXC_ECANCEL, as are all their later waits, and childs of a SEQ not yet started are
+ * skipped. fut is done with PROXC_ECANCEL when all PROCs in the
+ * tree have returned. Returns 1 if cancelled, else 0.
+ */
+int proxc_cancel(Future *fut)
+{
+    MONITOR_GATE();
+    ASSERT_NOTNULL(fut);
+
+    if (fut->is_done || !fut->root) {
+        return 0;
+    }
+    csp_cancelbuild(fut->root);
+    return 1;
+}
+
+/*
+ * Sets a deadline of usec relative to when build is started, 
+ * when the build is cancelled as if by proxc_cancel(). RUN of a
+ * tree cancelled returns PROXC_ECANCEL.
+ */
+Builder* proxc_deadline(Builder *build, uint64_t usec)
+{
+    MONITOR_GATE();
+    if (!build) return NULL;
+
+    build->header.deadline_us = (usec > 0) ? usec : 1;
+    return build;
+}
+
+int proxc_cancelled(void)
+{
+    MONITOR_GATE();
+    return proc_self()->is_cancelled;
+}
+
+/*
+ * Fire & forget a single PROC, without building a tree. 
+ * arg is accessed through proxc_argn(0) in fxn context.
+ */
+int proxc_spawn(ProcFxn fxn, void *arg)
+{
+    MONITOR_GATE();
+    ASSERT_NOTNULL(fxn);
+
+    PDEBUG("SPAWN PROC\n");
+
+    int ret;
+    Proc *proc;
+    if ((ret = proc_create(&proc, fxn))) {
+        return ret;
+    }
+    proc_setarg(proc, arg);
+    if ((ret = proc_prepare(proc))) {
+        proc_free(proc);
+        return ret;
+    }
+
+    scheduler_addready(proc);
+
+    return 0;
+}
+
+int proxc_spawnargs(ProcFxn fxn, const void *args, size_t size)
+{
+    MONITOR_GATE();
+    ASSERT_NOTNULL(fxn);
+
+    PDEBUG("SPAWN PROC with %zu bytes of args\n", size);
+
+    int ret;
+    Proc *proc;
+    if ((ret = proc_create(&proc, fxn))) {
+        return ret;
+    }
+    proc_setblob(proc, args, size);
+    if ((ret = proc_prepare(proc))) {
+        proc_free(proc);
+        return ret;
+    }
+
+    scheduler_addready(proc);
+
+    return 0;
+}
+
+static
+int _proxc_run(Builder *build)
+{
     Scheduler *sched = scheduler_self();
+    Proc *proc = sched->curr_proc;
+
+    /* a RUN of a child run inline is nested in the RUN of proc */
+    Builder *outer_build = proc->run_build;
+    int outer_status = proc->run_status;
 
     /* this triggers rescheduling of this PROC when RUN tree is done */
     build->header.is_root = 1;
-    build->header.run_proc = sched->curr_proc;
+    build->header.run_proc = proc;
+    proc->run_build  = build;
+    proc->run_status = 0;
+
+    /* pick a PROC to run on this stack, if there is room */
+    ProcBuild *inline_build = proc_caninline(sched->curr_proc)
+                            ? csp_inlinebuild(build)
+                            : NULL;
 
     PDEBUG("RUN building CSP tree\n");
     csp_runbuild(build);
     PDEBUG("RUN built CSP tree\n");
 
-    sched->curr_proc->state = PROC_RUNWAIT;
-    proc_yield(sched->curr_proc);
+    /* the tree of a cancelled PROC is cancelled from the start */
+    if (UNLIKELY(proc->is_cancelled)) {
+        csp_cancelbuild(build);
+    }
+
+    if (inline_build) {
+        proc_runinline(sched->curr_proc, inline_build->proc);
+    }
+    else {
+        sched->curr_proc->state = PROC_RUNWAIT;
+        proc_yield(sched->curr_proc);
+    }
 
     PDEBUG("RUN CSP tree finished\n");
 
+    int status = proc->run_status;
+    proc->run_build  = outer_build;
+    proc->run_status = outer_status;
+    /* a cancel during the nested RUN reached only its tree */
+    if (UNLIKELY(outer_build && proc->is_cancelled)) {
+        csp_cancelbuild(outer_build);
+    }
+    return status;
+}
+
+/*
+ * Runs root and waits for it to finish. A child of root may be run
+ * on the stack of the caller, if the caller is shallow enough, with
+ * up to MAX_INLINE_USED bytes less stack than a PROC of its own.
+ */
+int proxc_run(Builder *root)
+{
+    MONITOR_GATE();
+    ASSERT_NOTNULL(root);
+
     /* cleanup is done by the scheduler */
 
-    return 0;
+    return _proxc_run(BUILDER_CAST(root, Builder*));
+}
+
+/*
+ * Makes root, which must not be dispatched by GO or RUN, into a
+ * template which can be run any number of times by TMPLRUN. Its
+ * PROCs, stacks and builders are reused for each run.
+ */
+Template* proxc_tmplcreate(Builder *root)
+{
+    MONITOR_GATE();
+    ASSERT_NOTNULL(root);
+
+    PDEBUG("TEMPLATE created\n");
+
+    return csp_tmplcreate(root);
+}
+
+void proxc_tmplfree(Template *tmpl)
+{
+    MONITOR_GATE();
+    PDEBUG("TEMPLATE freed\n");
+    csp_tmplfree(tmpl);
+}
+
+/*
+ * RUN with the tree of tmpl, where arg is available to all its 
+ * PROCs through proxc_tmplarg(). A template can only have one
+ * run in progress, so EBUSY is returned if already running.
+ */
+int proxc_tmplrun(Template *tmpl, void *arg)
+{
+    MONITOR_GATE();
+    ASSERT_NOTNULL(tmpl);
+
+    if (tmpl->is_running) {
+        PDEBUG("TEMPLATE already running\n");
+        return EBUSY;
+    }
+    tmpl->arg = arg;
+    tmpl->is_running = 1;
+
+    csp_tmplreset(tmpl);
+
+    return _proxc_run(tmpl->root);
+}
+
+void* proxc_tmplarg(void)
+{
+    MONITOR_GATE();
+    Template *tmpl = proc_self()->args.tmpl;
+    return (tmpl) ? tmpl->arg : NULL;
 }
 
 Guard* proxc_guardchan(int cond, Chan *chan, void *out, size_t size)
 {
+    MONITOR_GATE();
     /* if cond is true, return ChanGuard */
     return (cond) 
         ? alt_guardcreate(GUARD_CHAN, 0, chan, out, size)
@@ -216,6 +612,7 @@ Guard* proxc_guardchan(int cond, Chan *chan, void *out, size_t size)
 
 Guard* proxc_guardtime(int cond, uint64_t usec)
 {
+    MONITOR_GATE();
     /* if cond is true and usec > 0, return TimerGuard */
     return (cond && usec > 0)
         ? alt_guardcreate(GUARD_TIME, usec + gettimestamp(), NULL, NULL, 0)
@@ -228,6 +625,7 @@ Guard* proxc_guardtime(int cond, uint64_t usec)
 
 Guard* proxc_guardskip(int cond)
 {
+    MONITOR_GATE();
     /* if cond is true, return SkipGuard*/
     return (cond)
         ? alt_guardcreate(GUARD_SKIP, 0, NULL, NULL, 0)
@@ -235,8 +633,57 @@ Guard* proxc_guardskip(int cond)
         : NULL;
 }
 
+Guard* proxc_guardcall(int cond, Call *call, void *req, size_t size)
+{
+    MONITOR_GATE();
+    /* if cond is true, return CallGuard */
+    return (cond)
+        ? alt_guardcreate(GUARD_CALL, 0, call, req, size)
+        /* else NULL */
+        : NULL;
+}
+
+Guard* proxc_guardfuture(int cond, Future *fut, void *out, size_t size)
+{
+    MONITOR_GATE();
+    return (cond)
+        ? alt_guardcreate(GUARD_FUTURE, 0, fut, out, size)
+        : NULL;
+}
+
+Guard* proxc_guardbar(int cond, Barrier *bar)
+{
+    MONITOR_GATE();
+    /* if cond is true, return BarrierGuard */
+    return (cond)
+        ? alt_guardcreate(GUARD_BAR, 0, bar, NULL, 0)
+        /* else NULL */
+        : NULL;
+}
+
+Guard* proxc_guardfd(int cond, int fd, int events)
+{
+    MONITOR_GATE();
+    /* if cond is true, return FdGuard */
+    Guard *guard = (cond)
+        ? alt_guardcreate(GUARD_FD, 0, NULL, NULL, 0)
+        /* else NULL */
+        : NULL;
+    if (guard) {
+        io_guardinit(guard, fd, events);
+    }
+    return guard;
+}
+
+/*
+ * Returns the key of the guard selected, or PROXC_EPOISON if the
+ * chan of the guard selected was poisoned, where the key is then
+ * given by proxc_altpoisoned(). A poisoned chan stays ready, so
+ * its guard should be disabled in the following ALTs.
+ */
 int proxc_alt(int arg_start, ...)
 {
+    MONITOR_GATE();
     Alt alt;
     alt_init(&alt);
 
@@ -258,23 +705,403 @@ int proxc_alt(int arg_start, ...)
     return key;
 }
 
+/*
+ * Replicated ALT, as ALT i = 0 FOR num in occam, reading 
+ * into out from one of chans. A NULL chan is inactive.
+ * Returns the index of the chan read from, or PROXC_EPOISON
+ * as ALT if that chan was poisoned. PROXC_EINVAL is returned
+ * if no chan is active, and PROXC_ENOMEM if out of memory.
+ */
+int proxc_altchans(Chan **chans, size_t num, void *out, size_t size)
+{
+    MONITOR_GATE();
+    return alt_selectchans(chans, num, out, size);
+}
+
+int proxc_altpoisoned(void)
+{
+    MONITOR_GATE();
+    return proc_self()->alt_poisoned;
+}
+
 Chan* proxc_chopen(size_t size)
 {
+    MONITOR_GATE();
     return chan_create(size); 
 }
 
+/*
+ * Poisons chan before it is freed, so no PROC is left 
+ * blocked on it. chan must not be used after this.
+ */
 void proxc_chclose(Chan *chan)
 {
+    MONITOR_GATE();
     chan_free(chan);
 }
 
+/*
+ * All blocked and following reads and writes on chan returns
+ * PROXC_EPOISON, and ALT guards on chan are selected, such that
+ * the ALT returns the error. A PROC receiving the
+ * error should poison its other chans, to propagate it.
+ */
+void proxc_chpoison(Chan *chan)
+{
+    MONITOR_GATE();
+    chan_poison(chan);
+}
+
 int proxc_chwrite(Chan *chan, void *data, size_t size)
 {
+    MONITOR_GATE();
     return chan_write(chan, data, size);
 }
 
 int proxc_chread(Chan *chan, void *data, size_t size)
 {
+    MONITOR_GATE();
     return chan_read(chan, data, size);
 }
 
+/*
+ * Returns PROXC_ETIMEOUT if no reader is found within usec. 
+ * A usec of 0 only succeeds if a reader is allready waiting.
+ */
+int proxc_chwrite_timeout(Chan *chan, void *data, size_t size, uint64_t usec)
+{
+    MONITOR_GATE();
+    return chan_timedwrite(chan, data, size, usec);
+}
+
+/*
+ * Returns PROXC_ETIMEOUT if no writer is found within usec. 
+ * A usec of 0 only succeeds if a writer is allready waiting.
+ */
+int proxc_chread_timeout(Chan *chan, void *data, size_t size, uint64_t usec)
+{
+    MONITOR_GATE();
+    return chan_timedread(chan, data, size, usec);
+}
+
+/*
+ * Opens a chan which yields a struct signalfd_siginfo for each of
+ * the signals in set delivered to the process, to be read or ALTed
+ * on by PROCs of the calling scheduler, and closed by CHCLOSE. The
+ * signals are blocked in the calling thread, and must be blocked
+ * in all other threads of the process as well.
+ */
+Chan* proxc_signal_chan(const sigset_t *set)
+{
+    MONITOR_GATE();
+    return sigchan_create(set);
+}
+
+/*
+ * Opens a chan which yields the uint64_t timestamp of a tick at
+ * each multiple of period, closed by CHCLOSE. A tick is read as
+ * late as the reader comes, and the ticks due meanwhile are then
+ * skipped by PROXC_TICK_SKIP, to the next multiple, or read at
+ * once as the latest which has passed by PROXC_TICK_COALESCE.
+ */
+Chan* proxc_ticker(uint64_t period, int policy)
+{
+    MONITOR_GATE();
+    if (period == 0) {
+        return NULL;
+    }
+    return ticker_create(period, 0, policy);
+}
+
+/* opens a chan which yields deadline once, as it has passed */
+Chan* proxc_timerchan(uint64_t deadline)
+{
+    MONITOR_GATE();
+    return ticker_create(0, deadline, PROXC_TICK_SKIP);
+}
+
+Call* proxc_callopen(size_t req_size, size_t resp_size)
+{
+    MONITOR_GATE();
+    return call_create(req_size, resp_size);
+}
+
+void proxc_callclose(Call *call)
+{
+    MONITOR_GATE();
+    call_free(call);
+}
+
+int proxc_call(Call *call, void *req, size_t req_size, void *resp, size_t resp_size)
+{
+    MONITOR_GATE();
+    return call_call(call, req, req_size, resp, resp_size);
+}
+
+/*
+ * Accepts a single call, and copies the request into req. 
+ * The client stays blocked until proxc_callreply() is 
+ * called by the same PROC on the same call.
+ */
+int proxc_callaccept(Call *call, void *req, size_t size)
+{
+    MONITOR_GATE();
+    return call_accept(call, req, size);
+}
+
+int proxc_callreply(Call *call, void *resp, size_t size)
+{
+    MONITOR_GATE();
+    return call_reply(call, resp, size);
+}
+
+Barrier* proxc_baropen(size_t enrolled)
+{
+    MONITOR_GATE();
+    return barrier_create(enrolled);
+}
+
+void proxc_barclose(Barrier *bar)
+{
+    MONITOR_GATE();
+    barrier_free(bar);
+}
+
+void proxc_barenroll(Barrier *bar)
+{
+    MONITOR_GATE();
+    barrier_enroll(bar);
+}
+
+void proxc_barresign(Barrier *bar)
+{
+    MONITOR_GATE();
+    barrier_resign(bar);
+}
+
+/*
+ * Blocks until all enrolled PROCs have synced on bar. The
+ * last PROC to sync releases all others, and does not block.
+ */
+int proxc_barsync(Barrier *bar)
+{
+    MONITOR_GATE();
+    return barrier_sync(bar);
+}
+
+Mutex* proxc_mtxopen(void)
+{
+    MONITOR_GATE();
+    return mutex_create();
+}
+
+void proxc_mtxclose(Mutex *mtx)
+{
+    MONITOR_GATE();
+    mutex_free(mtx);
+}
+
+int proxc_mtxlock(Mutex *mtx)
+{
+    MONITOR_GATE();
+    return mutex_lock(mtx);
+}
+
+int proxc_mtxtrylock(Mutex *mtx)
+{
+    MONITOR_GATE();
+    return mutex_trylock(mtx);
+}
+
+void proxc_mtxunlock(Mutex *mtx)
+{
+    MONITOR_GATE();
+    mutex_unlock(mtx);
+}
+
+Sem* proxc_semopen(size_t count)
+{
+    MONITOR_GATE();
+    return semaphore_create(count);
+}
+
+void proxc_semclose(Sem *sem)
+{
+    MONITOR_GATE();
+    semaphore_free(sem);
+}
+
+int proxc_semwait(Sem *sem)
+{
+    MONITOR_GATE();
+    return semaphore_wait(sem);
+}
+
+int proxc_semtrywait(Sem *sem)
+{
+    MONITOR_GATE();
+    return semaphore_trywait(sem);
+}
+
+void proxc_sempost(Sem *sem)
+{
+    MONITOR_GATE();
+    semaphore_post(sem);
+}
+
+Cond* proxc_condopen(void)
+{
+    MONITOR_GATE();
+    return cond_create();
+}
+
+void proxc_condclose(Cond *cond)
+{
+    MONITOR_GATE();
+    cond_free(cond);
+}
+
+/*
+ * mtx must be locked by the calling PROC, and is
+ * locked again by the calling PROC on return, also
+ * when PROXC_ECANCEL is returned.
+ */
+int proxc_condwait(Cond *cond, Mutex *mtx)
+{
+    MONITOR_GATE();
+    return cond_wait(cond, mtx);
+}
+
+void proxc_condsignal(Cond *cond)
+{
+    MONITOR_GATE();
+    cond_signal(cond);
+}
+
+void proxc_condbroadcast(Cond *cond)
+{
+    MONITOR_GATE();
+    cond_broadcast(cond);
+}
+
+/*
+ * I/O which parks the PROC instead of blocking the scheduler. The
+ * PROC waits in the epoll of its scheduler whenever the operation
+ * would block. Sockets are read and written with MSG_DONTWAIT, and
+ * other fds are non-blocking only during the call, so the flags of
+ * the caller are kept. These are cached per fd at its first call,
+ * until it is closed by proxc_close. Returns as the corresponding
+ * syscall, and sets errno to ECANCELED if the PROC is cancelled
+ * while waiting.
+ */
+ssize_t proxc_read(int fd, void *buf, size_t count)
+{
+    MONITOR_GATE_ERRNO();
+    return io_read(fd, buf, count);
+}
+
+ssize_t proxc_write(int fd, const void *buf, size_t count)
+{
+    MONITOR_GATE_ERRNO();
+    return io_write(fd, buf, count);
+}
+
+int proxc_accept(int fd, struct sockaddr *addr, socklen_t *addrlen)
+{
+    MONITOR_GATE_ERRNO();
+    return io_accept(fd, addr, addrlen);
+}
+
+int proxc_connect(int fd, const struct sockaddr *addr, socklen_t addrlen)
+{
+    MONITOR_GATE_ERRNO();
+    return io_connect(fd, addr, addrlen);
+}
+
+int proxc_close(int fd)
+{
+    MONITOR_GATE_ERRNO();
+    return io_close(fd);
+}
+
+/*
+ * File I/O, which parks the PROC while in flight when built with
+ * PROXC_IO_URING and io_uring is available, and else blocks the
+ * scheduler as the plain syscalls.
+ */
+ssize_t proxc_pread(int fd, void *buf, size_t count, off_t offset)
+{
+    MONITOR_GATE_ERRNO();
+    return io_pread(fd, buf, count, offset);
+}
+
+ssize_t proxc_pwrite(int fd, const void *buf, size_t count, off_t offset)
+{
+    MONITOR_GATE_ERRNO();
+    return io_pwrite(fd, buf, count, offset);
+}
+
+int proxc_fsync(int fd)
+{
+    MONITOR_GATE_ERRNO();
+    return io_fsync(fd, 0);
+}
+
+int proxc_fdatasync(int fd)
+{
+    MONITOR_GATE_ERRNO();
+    return io_fsync(fd, 1);
+}
+
+/*
+ * Runs a call which cannot be made non-blocking, such as
+ * getaddrinfo or fsync, on a thread of a bounded pool, and parks
+ * the PROC until it returns, so the other PROCs keep running.
+ */
+void* proxc_blocking(void *(*fxn)(void *), void *arg)
+{
+    MONITOR_GATE();
+    return pool_call(fxn, arg);
+}
+
+/*
+ * Monitors the scheduler of the calling PROC, which is handed to a
+ * spare thread when stuck in the code of one PROC for usec, as in
+ * a blocking call, so the other PROCs keep running. The PROC moves
+ * to that thread as it next calls into proxc, other than the calls
+ * returning errors in errno, which run blocking where it is.
+ */
+int proxc_monitor(uint64_t usec)
+{
+    MONITOR_GATE();
+    int ret = monitor_add(scheduler_self(), usec);
+    /* on the first enable the gate did nothing, so the caller is
+     * put in PROC code here, where it may be retaken */
+    if (ret == 0 && !_monitor_entered) {
+        _monitor_leave();
+    }
+    return ret;
+}
+
+/*
+ * Writes a copy of data to chan from any thread, also one without
+ * a scheduler, without waiting for a reader. The data is queued in
+ * chan on the scheduler which opened it, and written by one writer
+ * PROC of chan, so writes of one thread are read in order. The
+ * chans of SIGNAL_CHAN and TICKER take no injects. Returns 0, or
+ * an errno value.
+ */
+int proxc_inject(Chan *chan, const void *data)
+{
+    return inject_chan(chan, data);
+}
+
+/*
+ * Spawns a PROC of fxn with arg from any thread, on the scheduler
+ * of the calling thread if it has one, else on the first started.
+ * Returns 0, or ESRCH if no scheduler is running.
+ */
+int proxc_post(ProcFxn fxn, void *arg)
+{
+    return inject_post(fxn, arg);
+}
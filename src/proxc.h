@@ -4,66 +4,245 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/socket.h>
 
 #define PROXC_NULL  ((void *)-1)
 
+/* error returns of blocking operations */
+#define PROXC_EPOISON   (-1)
+#define PROXC_ETIMEOUT  (-2)
+#define PROXC_ECANCEL   (-3)
+#define PROXC_ENOMEM    (-4)
+#define PROXC_EINVAL    (-5)
+
+/* policies of tickers for missed ticks */
+#define PROXC_TICK_SKIP      0
+#define PROXC_TICK_COALESCE  1
+
 typedef void (*ProcFxn)(void);
 
 typedef struct Chan Chan;
+typedef struct Call Call;
+typedef struct Barrier Barrier;
+typedef struct Mutex Mutex;
+typedef struct Sem Sem;
+typedef struct Cond Cond;
 typedef struct Builder Builder;
+typedef struct Template Template;
+typedef struct Future Future;
 typedef struct Guard Guard;
 
 void proxc_start(ProcFxn fxn);
+
+int     proxc_init(void);
+void    proxc_fini(void);
+int     proxc_poll(uint64_t usec);
+int64_t proxc_next_deadline(void);
+int     proxc_fd(void);
+
 void proxc_exit(void);
 
 void* proxc_argn(size_t n);
+void* proxc_args(void);
 void  proxc_yield(void);
 
 void  proxc_sleep(uint64_t usec);
+void  proxc_sleep_until(uint64_t deadline);
+
+uint64_t proxc_timer(void);
 
 Builder* proxc_proc(ProcFxn, ...);
+Builder* proxc_procargs(ProcFxn fxn, const void *args, size_t size);
 Builder* proxc_par(int, ...);
+Builder* proxc_par_n(size_t num, ProcFxn fxn, void *args, size_t stride);
 Builder* proxc_seq(int, ...);
 
 int proxc_go(Builder *root);
+int proxc_spawn(ProcFxn fxn, void *arg);
+int proxc_spawnargs(ProcFxn fxn, const void *args, size_t size);
 int proxc_run(Builder *root);
 
+Future* proxc_gofuture(Builder *root, size_t size);
+void    proxc_futfree(Future *fut);
+int     proxc_result(const void *data, size_t size);
+int     proxc_await(Future *fut, void *out, size_t size);
+
+int      proxc_cancel(Future *fut);
+Builder* proxc_deadline(Builder *build, uint64_t usec);
+int      proxc_cancelled(void);
+
+Template* proxc_tmplcreate(Builder *root);
+void      proxc_tmplfree(Template *tmpl);
+int       proxc_tmplrun(Template *tmpl, void *arg);
+void*     proxc_tmplarg(void);
+
 Guard* proxc_guardchan(int cond, Chan* chan, void *out, size_t size);
 Guard* proxc_guardtime(int cond, uint64_t usec);
 Guard* proxc_guardskip(int cond);
+Guard* proxc_guardcall(int cond, Call *call, void *req, size_t size);
+Guard* proxc_guardbar(int cond, Barrier *bar);
+Guard* proxc_guardfuture(int cond, Future *fut, void *out, size_t size);
+Guard* proxc_guardfd(int cond, int fd, int events);
 int    proxc_alt(int, ...);
+int    proxc_altchans(Chan **chans, size_t num, void *out, size_t size);
+int    proxc_altpoisoned(void);
 
 Chan* proxc_chopen(size_t size);
 void  proxc_chclose(Chan *chan);
+void  proxc_chpoison(Chan *chan);
 int   proxc_chwrite(Chan *chan, void *data, size_t size);
 int   proxc_chread(Chan *chan, void *data, size_t size);
+int   proxc_chwrite_timeout(Chan *chan, void *data, size_t size, uint64_t usec);
+int   proxc_chread_timeout(Chan *chan, void *data, size_t size, uint64_t usec);
+
+Chan* proxc_signal_chan(const sigset_t *set);
+Chan* proxc_ticker(uint64_t period, int policy);
+Chan* proxc_timerchan(uint64_t deadline);
+
+Call* proxc_callopen(size_t req_size, size_t resp_size);
+void  proxc_callclose(Call *call);
+int   proxc_call(Call *call, void *req, size_t req_size, void *resp, size_t resp_size);
+int   proxc_callaccept(Call *call, void *req, size_t size);
+int   proxc_callreply(Call *call, void *resp, size_t size);
+
+Barrier* proxc_baropen(size_t enrolled);
+void     proxc_barclose(Barrier *bar);
+void     proxc_barenroll(Barrier *bar);
+void     proxc_barresign(Barrier *bar);
+int      proxc_barsync(Barrier *bar);
+
+Mutex* proxc_mtxopen(void);
+void   proxc_mtxclose(Mutex *mtx);
+int    proxc_mtxlock(Mutex *mtx);
+int    proxc_mtxtrylock(Mutex *mtx);
+void   proxc_mtxunlock(Mutex *mtx);
+
+Sem*  proxc_semopen(size_t count);
+void  proxc_semclose(Sem *sem);
+int   proxc_semwait(Sem *sem);
+int   proxc_semtrywait(Sem *sem);
+void  proxc_sempost(Sem *sem);
+
+Cond* proxc_condopen(void);
+void  proxc_condclose(Cond *cond);
+int   proxc_condwait(Cond *cond, Mutex *mtx);
+void  proxc_condsignal(Cond *cond);
+void  proxc_condbroadcast(Cond *cond);
+
+ssize_t proxc_read(int fd, void *buf, size_t count);
+ssize_t proxc_write(int fd, const void *buf, size_t count);
+int     proxc_accept(int fd, struct sockaddr *addr, socklen_t *addrlen);
+int     proxc_connect(int fd, const struct sockaddr *addr, socklen_t addrlen);
+int     proxc_close(int fd);
+ssize_t proxc_pread(int fd, void *buf, size_t count, off_t offset);
+ssize_t proxc_pwrite(int fd, const void *buf, size_t count, off_t offset);
+int     proxc_fsync(int fd);
+int     proxc_fdatasync(int fd);
+
+void* proxc_blocking(void *(*fxn)(void *), void *arg);
+
+int proxc_monitor(uint64_t usec);
+
+int proxc_inject(Chan *chan, const void *data);
+int proxc_post(ProcFxn fxn, void *arg);
 
 #ifndef PROXC_NO_MACRO
 
 #   define ARGN(index)  proxc_argn(index)
+#   define ARGS(type)   (*(type *)proxc_args())
 #   define YIELD()      proxc_yield()
 
 #   define SEC(sec)     MSEC(1000ULL * (uint64_t)(sec))
 #   define MSEC(msec)   USEC(1000ULL * (uint64_t)(msec))
 #   define USEC(usec)   ((uint64_t)(usec))
 #   define SLEEP(usec)  proxc_sleep((uint64_t)(usec))
+#   define SLEEP_UNTIL(deadline)  proxc_sleep_until((uint64_t)(deadline))
+#   define TIMER()      proxc_timer()
 
 #   define PROC(...)  proxc_proc(__VA_ARGS__, PROXC_NULL)
+#   define PROC_ARGS(fxn, type, ...)  proxc_procargs(fxn, &(type){ __VA_ARGS__ }, sizeof(type))
 #   define PAR(...)   proxc_par(0, __VA_ARGS__, PROXC_NULL)
+#   define PAR_N(num, fxn, args, stride)  proxc_par_n(num, fxn, args, stride)
 #   define SEQ(...)   proxc_seq(0, __VA_ARGS__, PROXC_NULL)
 
 #   define GO(build)   proxc_go(build)
 #   define RUN(build)  proxc_run(build)
 
+#   define GO_FUTURE(build, type)  proxc_gofuture(build, sizeof(type))
+#   define FUTFREE(fut)            proxc_futfree(fut)
+#   define RESULT(data, type)      proxc_result(data, sizeof(type))
+#   define AWAIT(fut, out, type)   proxc_await(fut, out, sizeof(type))
+
+#   define CANCEL(fut)              proxc_cancel(fut)
+#   define DEADLINE(build, usec)    proxc_deadline(build, usec)
+#   define CANCELLED()              proxc_cancelled()
+
+#   define SPAWN(fxn, arg)  proxc_spawn(fxn, arg)
+#   define SPAWN_ARGS(fxn, type, ...)  proxc_spawnargs(fxn, &(type){ __VA_ARGS__ }, sizeof(type))
+
+#   define TMPLCREATE(build)   proxc_tmplcreate(build)
+#   define TMPLFREE(tmpl)      proxc_tmplfree(tmpl)
+#   define TMPLRUN(tmpl, arg)  proxc_tmplrun(tmpl, arg)
+#   define TMPLARG()           proxc_tmplarg()
+
 #   define CHAN_GUARD(cond, ch, out, type)  proxc_guardchan(cond, ch, out, sizeof(type))
 #   define TIME_GUARD(cond, usec)           proxc_guardtime(cond, usec)
 #   define SKIP_GUARD(cond)                 proxc_guardskip(cond)
+#   define CALL_GUARD(cond, call, req, type) proxc_guardcall(cond, call, req, sizeof(type))
+#   define BAR_GUARD(cond, bar)             proxc_guardbar(cond, bar)
+#   define FUTURE_GUARD(cond, fut, out, type) proxc_guardfuture(cond, fut, out, sizeof(type))
+#   define FD_GUARD(cond, fd, events)       proxc_guardfd(cond, fd, events)
 #   define ALT(...)                         proxc_alt(0, __VA_ARGS__, PROXC_NULL)
+#   define ALT_CHANS(chans, num, out, type)  proxc_altchans(chans, num, out, sizeof(type))
+#   define ALT_POISONED()                    proxc_altpoisoned()
+
+#   define BLOCKING(fxn, arg)  proxc_blocking(fxn, arg)
+#   define MONITOR(usec)       proxc_monitor(usec)
+#   define INJECT(chan, data)  proxc_inject(chan, data)
+#   define POST(fxn, arg)      proxc_post(fxn, arg)
 
 #   define CHOPEN(type)               proxc_chopen(sizeof(type))
 #   define CHCLOSE(chan)              proxc_chclose(chan)
+#   define CHPOISON(chan)             proxc_chpoison(chan)
 #   define CHWRITE(chan, data, type)  proxc_chwrite(chan, data, sizeof(type))
 #   define CHREAD(chan, data, type)   proxc_chread(chan, data, sizeof(type)) 
+#   define CHWRITE_TIMEOUT(chan, data, type, usec)  proxc_chwrite_timeout(chan, data, sizeof(type), usec)
+#   define CHREAD_TIMEOUT(chan, data, type, usec)   proxc_chread_timeout(chan, data, sizeof(type), usec)
+#   define SIGNAL_CHAN(set)           proxc_signal_chan(set)
+#   define TICKER(period, policy)     proxc_ticker(period, policy)
+#   define TIMER_CHAN(deadline)       proxc_timerchan(deadline)
+
+#   define CALLOPEN(req_type, resp_type)  proxc_callopen(sizeof(req_type), sizeof(resp_type))
+#   define CALLCLOSE(call)                proxc_callclose(call)
+#   define CALL(call, req, req_type, resp, resp_type)  proxc_call(call, req, sizeof(req_type), resp, sizeof(resp_type))
+#   define ACCEPT(call, req, type)        proxc_callaccept(call, req, sizeof(type))
+#   define REPLY(call, resp, type)        proxc_callreply(call, resp, sizeof(type))
+
+#   define BAROPEN(enrolled)  proxc_baropen(enrolled)
+#   define BARCLOSE(bar)      proxc_barclose(bar)
+#   define ENROLL(bar)        proxc_barenroll(bar)
+#   define RESIGN(bar)        proxc_barresign(bar)
+#   define SYNC(bar)          proxc_barsync(bar)
+
+#   define MTXOPEN()        proxc_mtxopen()
+#   define MTXCLOSE(mtx)    proxc_mtxclose(mtx)
+#   define MTXLOCK(mtx)     proxc_mtxlock(mtx)
+#   define MTXTRYLOCK(mtx)  proxc_mtxtrylock(mtx)
+#   define MTXUNLOCK(mtx)   proxc_mtxunlock(mtx)
+
+#   define SEMOPEN(count)  proxc_semopen(count)
+#   define SEMCLOSE(sem)   proxc_semclose(sem)
+#   define SEMWAIT(sem)    proxc_semwait(sem)
+#   define SEMTRYWAIT(sem) proxc_semtrywait(sem)
+#   define SEMPOST(sem)    proxc_sempost(sem)
+
+#   define CONDOPEN()           proxc_condopen()
+#   define CONDCLOSE(cond)      proxc_condclose(cond)
+#   define CONDWAIT(cond, mtx)  proxc_condwait(cond, mtx)
+#   define CONDSIGNAL(cond)     proxc_condsignal(cond)
+#   define CONDBROADCAST(cond)  proxc_condbroadcast(cond)
 
 #endif /* PROXC_NO_MACRO */
 
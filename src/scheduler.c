@@ -6,6 +6,8 @@
 #include <unistd.h>
 #include <ucontext.h>
 #include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 
 #include "internal.h"
 
@@ -36,6 +38,13 @@ Scheduler* scheduler_self(void)
     return sched;
 }
 
+/* as scheduler_self, but NULL on threads without a scheduler */
+Scheduler* scheduler_current(void)
+{
+    pthread_once(&g_key_once, _scheduler_key_create);
+    return pthread_getspecific(g_key_sched);
+}
+
 static inline
 int _sleep_cmp(Proc *p1, Proc *p2)
 {
@@ -56,8 +65,25 @@ int _altsleep_cmp(Guard *g1, Guard *g2)
                                   :  1;
 }
 
+static inline
+int _timer_cmp(Timer *t1, Timer *t2)
+{
+    ASSERT_NOTNULL(t1);
+    ASSERT_NOTNULL(t2);
+    return (t1->usec  < t2->usec) ? -1
+         : (t1->usec == t2->usec) ?  0
+                                  :  1;
+}
+
 RB_GENERATE(ProcRB_sleep, Proc, sleepRB_node, _sleep_cmp)
 RB_GENERATE(GuardRB_altsleep, Guard, sleepRB_node, _altsleep_cmp)
+RB_GENERATE(TimerRB, Timer, node, _timer_cmp)
+
+static inline
+void** _scheduler_stacklink(Scheduler *sched, void *stack)
+{
+    return (void **)((char *)stack + sched->stack_size) - 1;
+}
 
 int scheduler_create(Scheduler **new_sched)
 {
@@ -72,8 +98,29 @@ int scheduler_create(Scheduler **new_sched)
     /* configure members */
     sched->stack_size = MAX_STACK_SIZE;
     sched->page_size  = (size_t)sysconf(_SC_PAGESIZE);
-
-    sched->is_exit = 0;
+    sched->stack_cache.num  = 0;
+    sched->stack_cache.head = NULL;
+    sched->build_arena = NULL;
+    sched->poller      = NULL;
+    sched->poll_tick   = 0;
+    sched->uring       = NULL;
+    sched->no_uring    = 0;
+    sched->wake.fd     = -1;
+    sched->pool_done   = NULL;
+    sched->remote      = NULL;
+    sched->injectQ     = NULL;
+    sched->wake_refs   = 0;
+    sched->mon.is_on   = 0;
+    sched->mon.state   = 0;
+    sched->mon.tick    = 0;
+    sched->mon.is_done = 0;
+    sched->mon.worker  = NULL;
+    sched->mon.next    = NULL;
+
+    sched->is_exit     = 0;
+    sched->is_embedded = 0;
+    sched->main_proc   = NULL;
+    sched->curr_proc   = NULL;
 
     // Save scheduler for this pthread
     int ret;
@@ -84,6 +131,7 @@ int scheduler_create(Scheduler **new_sched)
 
     // and context
     ctx_init(&sched->ctx, NULL);
+    sched->loop_ctx = &sched->ctx;
 
     TAILQ_INIT(&sched->totalQ);
     TAILQ_INIT(&sched->readyQ);
@@ -91,6 +139,8 @@ int scheduler_create(Scheduler **new_sched)
     RB_INIT(&sched->sleep.RB);
     sched->altsleep.num = 0;
     RB_INIT(&sched->altsleep.RB);
+    sched->timers.num = 0;
+    RB_INIT(&sched->timers.RB);
 
     *new_sched = sched;
 
@@ -107,9 +157,78 @@ void scheduler_free(Scheduler *sched)
         proc_free(proc);
     }
 
+    void *stack;
+    while ((stack = sched->stack_cache.head)) {
+        sched->stack_cache.head = *_scheduler_stacklink(sched, stack);
+        free(stack);
+    }
+
+    /* no more posts from other threads, then wait for those waking this */
+    inject_unregister(sched);
+    while (__atomic_load_n(&sched->wake_refs, __ATOMIC_ACQUIRE) > 0) {
+        sched_yield();
+    }
+    if (sched->wake.fd != -1) {
+        io_remsource(sched->poller, &sched->wake.wait);
+        close(sched->wake.fd);
+    }
+    inject_free(sched);
+
+#ifdef PROXC_IO_URING
+    uring_free(sched, sched->uring);
+#endif
+    io_free(sched->poller);
+
+    if (pthread_getspecific(g_key_sched) == sched) {
+        pthread_setspecific(g_key_sched, NULL);
+    }
+
+    /* arenas no longer current are freed by their last builder */
+    if (sched->build_arena && sched->build_arena->live == 0) {
+        arena_free(sched->build_arena);
+    }
+
     free(sched);
 }
 
+/*
+ * Returns a free stack, the most recently put is reused first as
+ * its top pages are most likely still mapped, and else allocates.
+ */
+void* scheduler_getstack(Scheduler *sched)
+{
+    ASSERT_NOTNULL(sched);
+
+    void *stack = sched->stack_cache.head;
+    if (stack) {
+        sched->stack_cache.head = *_scheduler_stacklink(sched, stack);
+        sched->stack_cache.num--;
+        return stack;
+    }
+
+    if (posix_memalign(&stack, sched->page_size, sched->stack_size)) {
+        PERROR("posix_memalign failed\n");
+        return NULL;
+    }
+    return stack;
+}
+
+void scheduler_putstack(Scheduler *sched, void *stack)
+{
+    ASSERT_NOTNULL(sched);
+
+    if (!stack) return;
+
+    if (sched->stack_cache.num == MAX_STACK_CACHE) {
+        free(stack);
+        return;
+    }
+
+    *_scheduler_stacklink(sched, stack) = sched->stack_cache.head;
+    sched->stack_cache.head = stack;
+    sched->stack_cache.num++;
+}
+
 void scheduler_addready(Proc *proc)
 {
     ASSERT_NOTNULL(proc);
@@ -188,12 +307,146 @@ void scheduler_remaltsleep(Guard *guard)
     --sched->altsleep.num;
 }
 
+void scheduler_addtimer(Scheduler *sched, Timer *timer)
+{
+    ASSERT_NOTNULL(sched);
+    ASSERT_NOTNULL(timer);
+    ASSERT_TRUE(!timer->is_armed);
+
+    PDEBUG("scheduler_addtimer called\n");
+
+    size_t num_tries = 0;
+    enum { MAX_TRIES = 1000 };
+    while (RB_INSERT(TimerRB, &sched->timers.RB, timer) && (++num_tries < MAX_TRIES)) {
+        /* this means there is a key collision, increment usec */
+        ++timer->usec;
+    }
+    ASSERT_TRUE(num_tries < MAX_TRIES);
+    ++sched->timers.num;
+    timer->is_armed = 1;
+}
+
+void scheduler_remtimer(Scheduler *sched, Timer *timer)
+{
+    ASSERT_NOTNULL(sched);
+    ASSERT_NOTNULL(timer);
+
+    if (!timer->is_armed) return;
+
+    RB_REMOVE(TimerRB, &sched->timers.RB, timer);
+    --sched->timers.num;
+    timer->is_armed = 0;
+}
+
+/*
+ * Hands proc to sched from another thread, pushed to its remote
+ * LIFO where the first push after a drain wakes the scheduler.
+ */
+void scheduler_pushremote(Scheduler *sched, Proc *proc)
+{
+    ASSERT_NOTNULL(sched);
+    ASSERT_NOTNULL(proc);
+
+    /* the scheduler is not freed while this refers to it */
+    __atomic_add_fetch(&sched->wake_refs, 1, __ATOMIC_ACQ_REL);
+
+    Proc *head = __atomic_load_n(&sched->remote, __ATOMIC_RELAXED);
+    do {
+        proc->remote_next = head;
+    } while (!__atomic_compare_exchange_n(&sched->remote, &head, proc, 1,
+                                          __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+    if (!head) {
+        scheduler_notify(sched);
+    }
+
+    __atomic_sub_fetch(&sched->wake_refs, 1, __ATOMIC_RELEASE);
+}
+
+/* readies the PROCs handed over since the last drain, in order */
+static
+void _scheduler_drainremote(Scheduler *sched)
+{
+    Proc *proc = __atomic_exchange_n(&sched->remote, NULL, __ATOMIC_ACQUIRE);
+
+    Proc *prev = NULL, *next;
+    for (; proc; proc = next) {
+        next = proc->remote_next;
+        proc->remote_next = prev;
+        prev = proc;
+    }
+    for (proc = prev; proc; proc = next) {
+        next = proc->remote_next;
+        scheduler_addready(proc);
+    }
+}
+
+static
+void _scheduler_woken(void *arg)
+{
+    Scheduler *sched = arg;
+
+    uint64_t val;
+    if (read(sched->wake.fd, &val, sizeof(val)) == -1 && errno != EAGAIN) {
+        PERROR("read failed for wake eventfd\n");
+    }
+    pool_drain(sched);
+    _scheduler_drainremote(sched);
+    inject_drain(sched);
+}
+
+/*
+ * Sets up the eventfd which other threads wake the scheduler by,
+ * on first use, as the scheduler may be sleeping in the poller.
+ */
+int scheduler_initwake(Scheduler *sched)
+{
+    ASSERT_NOTNULL(sched);
+
+    if (LIKELY(sched->wake.fd != -1)) {
+        return 0;
+    }
+
+    Poller *poller = io_poller(sched);
+    if (!poller) {
+        return ENOMEM;
+    }
+    int fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (fd == -1) {
+        PERROR("eventfd failed\n");
+        return errno;
+    }
+    sched->wake.wait.fd     = fd;
+    sched->wake.wait.events = EPOLLIN;
+    sched->wake.wait.fxn    = _scheduler_woken;
+    sched->wake.wait.arg    = sched;
+    int ret;
+    if ((ret = io_addsource(poller, &sched->wake.wait))) {
+        close(fd);
+        return ret;
+    }
+    sched->wake.fd = fd;
+    return 0;
+}
+
+/*
+ * Wakes the scheduler, safe to call from any thread once the
+ * scheduler has called scheduler_initwake.
+ */
+void scheduler_notify(Scheduler *sched)
+{
+    uint64_t val = 1;
+    if (write(sched->wake.fd, &val, sizeof(val)) == -1 && errno != EAGAIN) {
+        PERROR("write failed for wake eventfd\n");
+    }
+}
+
 static
 void _scheduler_wakeup(Scheduler *sched)
 {
     ASSERT_NOTNULL(sched);
 
-    if (RB_EMPTY(&sched->sleep.RB) && RB_EMPTY(&sched->altsleep.RB)) {
+    if (RB_EMPTY(&sched->sleep.RB) && RB_EMPTY(&sched->altsleep.RB)
+        && RB_EMPTY(&sched->timers.RB)) {
         return;
     } 
 
@@ -205,6 +458,12 @@ void _scheduler_wakeup(Scheduler *sched)
         }
         PDEBUG("PROC timeout\n");
         scheduler_remsleep(proc);
+        if (proc->state == PROC_CHANWAIT) {
+            chan_timeout(proc->ch_end);
+        }
+        else if (proc->state == PROC_IOWAIT) {
+            io_timeout(proc->io_wait);
+        }
         scheduler_addready(proc);
     }
 
@@ -222,17 +481,22 @@ void _scheduler_wakeup(Scheduler *sched)
             }
         }
     }
+
+    Timer *timer;
+    while ((timer = RB_MIN(TimerRB, &sched->timers.RB))) {
+        if (timer->usec > now_us) {
+            break;
+        }
+        PDEBUG("TIMER fired\n");
+        scheduler_remtimer(sched, timer);
+        timer->fxn(timer->arg);
+    }
 }
 
+/* returns the first timeout of sleeps, ALTs and timers, 0 if none */
 static inline
-void _scheduler_checkQs(Scheduler *sched)
+uint64_t _scheduler_mintimeout(Scheduler *sched)
 {
-    ASSERT_NOTNULL(sched);
-
-    if (!TAILQ_EMPTY(&sched->readyQ)) {
-        return;
-    }
-    
     uint64_t min_us = 0;
     Proc *proc;
     if (!RB_EMPTY(&sched->sleep.RB)) {
@@ -250,7 +514,72 @@ void _scheduler_checkQs(Scheduler *sched)
         }
     }
 
-    if (min_us > 0) {
+    Timer *timer;
+    if (!RB_EMPTY(&sched->timers.RB)) {
+        timer = RB_MIN(TimerRB, &sched->timers.RB);
+        if (timer && (min_us == 0 || timer->usec < min_us)) {
+            min_us = timer->usec;
+        }
+    }
+    return min_us;
+}
+
+/*
+ * Sleeps until the first timeout if no PROC is ready. With PROCs
+ * waiting on I/O, the sleep is a poll instead, which io_poll waits
+ * to the us, else in ms rounded up, so any fd ready meanwhile wakes
+ * it, and while PROCs are ready they are polled for every so often.
+ * An embedded scheduler never sleeps, but polls without waiting.
+ */
+static inline
+void _scheduler_checkQs(Scheduler *sched, int can_sleep)
+{
+    ASSERT_NOTNULL(sched);
+
+#ifdef PROXC_IO_URING
+    if (sched->uring) {
+        uring_flush(sched->uring, TAILQ_EMPTY(&sched->readyQ));
+    }
+#endif
+
+    /* a load each round, so done calls are not left until a poll */
+    if (__atomic_load_n(&sched->pool_done, __ATOMIC_RELAXED)) {
+        pool_drain(sched);
+    }
+    if (__atomic_load_n(&sched->remote, __ATOMIC_RELAXED)) {
+        _scheduler_drainremote(sched);
+    }
+    if (__atomic_load_n(&sched->injectQ, __ATOMIC_RELAXED)) {
+        inject_drain(sched);
+    }
+
+    /* sources such as the wake eventfd are only polled when idle */
+    Poller *poller = sched->poller;
+    int is_polling = poller && poller->num_waits > poller->num_sources;
+
+    if (!TAILQ_EMPTY(&sched->readyQ)) {
+        if (is_polling && (++sched->poll_tick % IO_POLL_ROUNDS) == 0) {
+            io_poll(poller, 0);
+        }
+        return;
+    }
+    if (!can_sleep) {
+        if (poller && poller->num_waits > 0) {
+            io_poll(poller, 0);
+        }
+        return;
+    }
+    
+    uint64_t min_us = _scheduler_mintimeout(sched);
+    if (poller && poller->num_waits > 0) {
+        int64_t timeout_us = -1;
+        if (min_us > 0) {
+            uint64_t now_us = gettimestamp();
+            timeout_us = (min_us > now_us) ? (int64_t)(min_us - now_us) : 0;
+        }
+        io_poll(poller, timeout_us);
+    }
+    else if (min_us > 0) {
         uint64_t now_us = gettimestamp();
         if (min_us > now_us) {
             usleep((useconds_t)(min_us - now_us));
@@ -264,16 +593,93 @@ int _scheduler_running(Scheduler *sched)
     return !sched->is_exit && !TAILQ_EMPTY(&sched->totalQ);
 }
 
-int scheduler_run(void)
+/*
+ * Switches to proc, and files it by its state as it yields back.
+ * Returns 1 if the thread of worker lost sched meanwhile.
+ */
+static inline
+int _scheduler_resume(Scheduler *sched, Worker *worker, Proc *proc)
+{
+    /* bulk PROCs take a stack when first run */
+    if (UNLIKELY(!proc->stack.ptr) && proc_prepare(proc)) {
+        PANIC("Proc stack could not be allocated\n");
+    }
+    sched->curr_proc        = proc;
+    sched->curr_proc->state = PROC_RUNNING;
+
+    /* context switch to proc */
+    ctx_switch(sched->loop_ctx, &sched->curr_proc->ctx);
+
+    /* the monitor retook sched, and the PROC left for its new thread */
+    if (UNLIKELY(worker->is_lost)) {
+        scheduler_pushremote(sched, worker->lost_proc);
+        return 1;
+    }
+    ctx_madvise(sched->curr_proc);
+
+    switch (sched->curr_proc->state) {
+    case PROC_RUNNING:
+    case PROC_READY:
+        scheduler_addready(sched->curr_proc);
+        break;
+    case PROC_ENDED:
+        /* termination test */
+        sched->is_exit = sched->is_exit || (sched->curr_proc == sched->main_proc);
+
+        /* cleanup */
+        proc_free(sched->curr_proc);
+        break;
+    case PROC_RUNWAIT:
+        /* do nothing, as this proc will be revived  */
+        break;
+    case PROC_CHANWAIT:
+        /* do nothing, the other end of CHAN will re-add it */
+        break;
+    case PROC_CALLWAIT:
+        /* do nothing, the other end of CALL will re-add it */
+        break;
+    case PROC_BARWAIT:
+        /* do nothing, the last PROC to sync will re-add it */
+        break;
+    case PROC_LOCKWAIT:
+    case PROC_SEMWAIT:
+    case PROC_CONDWAIT:
+        /* do nothing, unlock, post or signal will re-add it */
+        break;
+    case PROC_FUTWAIT:
+        /* do nothing, the tree of the future will re-add it */
+        break;
+    case PROC_IOWAIT:
+    case PROC_URINGWAIT:
+        /* do nothing, the poller will re-add it */
+        break;
+    case PROC_POOLWAIT:
+        /* do nothing, the scheduler re-adds it when the call is done */
+        break;
+    default:
+        break;
+    }
+
+    sched->curr_proc = NULL;
+    return 0;
+}
+
+/* the loop of a thread ends when the scheduler is done, or lost */
+enum {
+    SCHED_DONE,
+    SCHED_LOST
+};
+
+static
+int _scheduler_loop(Scheduler *sched, Worker *worker)
 {
-    Scheduler *sched = scheduler_self();
     Proc *curr_proc;
 
     while (_scheduler_running(sched)) {
         PDEBUG("This is from scheduler!\n");
 
         /* check content of Qs, sleep if no active */
-        _scheduler_checkQs(sched);
+        _scheduler_checkQs(sched, 1);
 
         /* wake up sleeping PROC if timeout */
         _scheduler_wakeup(sched);
@@ -290,37 +696,31 @@ int scheduler_run(void)
 
         /* from here, a PROC is found to resume */
         ASSERT_NOTNULL(curr_proc);
-        
-        sched->curr_proc        = curr_proc;
-        sched->curr_proc->state = PROC_RUNNING;
-
-        /* context switch to proc */
-        ctx_switch(&sched->ctx, &sched->curr_proc->ctx);
-        ctx_madvise(sched->curr_proc);
-
-        switch (sched->curr_proc->state) {
-        case PROC_RUNNING:
-        case PROC_READY:
-            scheduler_addready(sched->curr_proc);
-            break;
-        case PROC_ENDED:
-            /* termination test */
-            sched->is_exit = sched->is_exit || (sched->curr_proc == sched->main_proc);
-                    
-            /* cleanup */
-            proc_free(sched->curr_proc);
-            break;
-        case PROC_RUNWAIT:
-            /* do nothing, as this proc will be revived  */
-            break;
-        case PROC_CHANWAIT:
-            /* do nothing, the other end of CHAN will re-add it */
-            break;
-        default:
-            break;
+
+        if (UNLIKELY(_scheduler_resume(sched, worker, curr_proc))) {
+            return SCHED_LOST;
         }
+    }
 
-        sched->curr_proc = NULL;
+    return SCHED_DONE;
+}
+
+int scheduler_run(void)
+{
+    Scheduler *sched = scheduler_self();
+    Worker *home = &sched->mon.home;
+    monitor_bind(sched, home);
+    /* other threads may inject into any running scheduler */
+    if (!scheduler_initwake(sched)) {
+        inject_register(sched);
+    }
+
+    if (_scheduler_loop(sched, home) == SCHED_LOST) {
+        /* the scheduler is finished by spares, wait for it */
+        monitor_wait(sched);
+    }
+    else {
+        monitor_remove(sched);
     }
 
     PDEBUG("scheduler_run done\n");
@@ -328,3 +728,74 @@ int scheduler_run(void)
     return 0;
 }
 
+/*
+ * Runs the scheduler of worker, handed to it by the monitor, and
+ * returns 1 when the scheduler is done, or 0 if it was lost as well.
+ */
+int scheduler_takeover(Worker *worker)
+{
+    ASSERT_NOTNULL(worker);
+
+    Scheduler *sched = worker->sched;
+    int ret = pthread_setspecific(g_key_sched, sched);
+    ASSERT_0(ret);
+    sched->loop_ctx = worker->ctx;
+
+    PDEBUG("scheduler taken over\n");
+
+    ret = _scheduler_loop(sched, worker);
+    pthread_setspecific(g_key_sched, NULL);
+    return ret == SCHED_DONE;
+}
+
+/*
+ * Runs an embedded scheduler, driven by a loop of the caller, until
+ * no PROC is ready or usec has passed, with timeouts and I/O polled
+ * without waiting. Returns 1 while PROCs remain, and 0 once done.
+ */
+int scheduler_poll(Scheduler *sched, uint64_t usec)
+{
+    ASSERT_NOTNULL(sched);
+    ASSERT_TRUE(!sched->curr_proc);
+
+    uint64_t end_us = gettimestamp() + usec;
+    while (_scheduler_running(sched)) {
+        _scheduler_checkQs(sched, 0);
+        _scheduler_wakeup(sched);
+
+        Proc *proc = TAILQ_FIRST(&sched->readyQ);
+        if (!proc) {
+            break;
+        }
+        TAILQ_REMOVE(&sched->readyQ, proc, readyQ_next);
+        _scheduler_resume(sched, sched->mon.worker, proc);
+
+        if (gettimestamp() >= end_us) {
+            break;
+        }
+    }
+    return _scheduler_running(sched);
+}
+
+/*
+ * Returns the usec until an embedded scheduler has to be polled,
+ * 0 if a PROC is ready, and -1 if none waits on a timeout, when
+ * only the poller fd becoming readable needs a poll.
+ */
+int64_t scheduler_nexttimeout(Scheduler *sched)
+{
+    ASSERT_NOTNULL(sched);
+
+    if (!TAILQ_EMPTY(&sched->readyQ)
+        || __atomic_load_n(&sched->pool_done, __ATOMIC_RELAXED)
+        || __atomic_load_n(&sched->remote, __ATOMIC_RELAXED)
+        || __atomic_load_n(&sched->injectQ, __ATOMIC_RELAXED)) {
+        return 0;
+    }
+    uint64_t min_us = _scheduler_mintimeout(sched);
+    if (min_us == 0) {
+        return -1;
+    }
+    uint64_t now_us = gettimestamp();
+    return (min_us > now_us) ? (int64_t)(min_us - now_us) : 0;
+}
@@ -7,15 +7,82 @@
 
 #include "internal.h"
 
+/* 
+ * Generic timer, calling fxn with arg from the scheduler
+ * when usec, an absolute timestamp, has passed.
+ */
+struct Timer {
+    uint64_t  usec;
+    void      (*fxn)(void *arg);
+    void      *arg;
+    int       is_armed;
+
+    RB_ENTRY(Timer)  node;
+};
+
 struct Scheduler {
     uint64_t  id;
     Ctx       ctx;
+    /* context yielded to, of the thread currently running this */
+    Ctx       *loop_ctx;
 
     size_t  stack_size;
     size_t  page_size; 
 
+    /* LIFO of free stacks, linked through their top word */
+    struct {
+        size_t  num;
+        void    *head;
+    } stack_cache;
+
+    /* arena which builders are currently allocated from */
+    struct Arena  *build_arena;
+
+    /* epoll of PROCs waiting on I/O, created at first wait */
+    struct Poller  *poller;
+    size_t  poll_tick;
+
+    /* io_uring of file I/O, if built with and available */
+    struct Uring  *uring;
+    int  no_uring;
+
+    /* eventfd in the poller, which other threads wake the scheduler by */
+    struct {
+        int     fd;
+        IoWait  wait;
+    } wake;
+
+    /* blocking calls done by the pool, a LIFO pushed by its threads */
+    struct PoolJob  *pool_done;
+    /* PROCs handed back by threads which lost this, a LIFO as well */
+    struct Proc  *remote;
+    /* PROCs to spawn posted by any thread, a LIFO as well */
+    struct Inject  *injectQ;
+    /* other threads currently waking this */
+    size_t  wake_refs;
+
+    /* stall monitor, if enabled for this scheduler */
+    struct {
+        int  is_on;
+        /* generation of the owner << 1, | 1 while it runs PROC code */
+        uint64_t  state;
+        /* returns to PROC code, and the last seen by the monitor */
+        uint64_t  tick;
+        uint64_t  seen_tick;
+        uint64_t  seen_us;
+        int  is_done;
+
+        /* thread running this, and the one that started it */
+        struct Worker  *worker;
+        struct Worker  home;
+
+        struct Scheduler  *next;
+    } mon;
+
     int   is_exit;
     Proc  *main_proc;
+    /* driven by a loop of the caller instead of scheduler_run */
+    int   is_embedded;
 
     struct Proc  *curr_proc;
 
@@ -31,6 +98,10 @@ struct Scheduler {
         size_t num;
         struct GuardRB_altsleep  RB;
     } altsleep;
+    struct {
+        size_t num;
+        struct TimerRB  RB;
+    } timers;
 };
 
 #endif /* SCHEDULER_H__ */
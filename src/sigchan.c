@@ -0,0 +1,129 @@
+
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+
+#include "internal.h"
+
+static
+void _sigchan_close(SigChan *sc)
+{
+    close(sc->fd);
+    free(sc);
+}
+
+/* yields the pending records, until none is left */
+static
+void* _sigchan_read(ChanSource *src)
+{
+    SigChan *sc = (SigChan *)src;
+
+    if (read(sc->fd, &sc->info, sizeof(sc->info)) != sizeof(sc->info)) {
+        if (errno != EAGAIN) {
+            PERROR("read failed for signalfd\n");
+        }
+        return NULL;
+    }
+    return &sc->info;
+}
+
+/* watches the fd again as the relay ends, unless chan is poisoned */
+static
+void _sigchan_idle(ChanSource *src)
+{
+    SigChan *sc = (SigChan *)src;
+
+    if (src->chan->is_poisoned) {
+        return;
+    }
+    if (io_addwatch(sc->sched->poller, &sc->wait)) {
+        PERROR("io_addwatch failed for signalfd\n");
+        return;
+    }
+    sc->is_watched = 1;
+}
+
+static
+void _sigchan_free(ChanSource *src)
+{
+    SigChan *sc = (SigChan *)src;
+
+    if (sc->is_watched) {
+        io_remwatch(sc->sched->poller, &sc->wait);
+    }
+    _sigchan_close(sc);
+}
+
+/* called by the poller as a signal is pending, starts the relay */
+static
+void _sigchan_ready(void *arg)
+{
+    SigChan *sc = arg;
+
+    if (source_start(&sc->src)) {
+        return;
+    }
+    io_remwatch(sc->sched->poller, &sc->wait);
+    sc->is_watched = 0;
+}
+
+/*
+ * Opens a chan of struct signalfd_siginfo, which the signals of
+ * set are read from, as they are delivered to the process. The
+ * signals are blocked in the calling thread, and must be blocked
+ * in all other threads as well, else they may be handled there.
+ */
+Chan* sigchan_create(const sigset_t *set)
+{
+    ASSERT_NOTNULL(set);
+
+    Scheduler *sched = scheduler_self();
+    Poller *poller = io_poller(sched);
+    if (!poller) {
+        return NULL;
+    }
+
+    SigChan *sc;
+    if (!(sc = malloc(sizeof(SigChan)))) {
+        PERROR("malloc failed for SigChan\n");
+        return NULL;
+    }
+    if (pthread_sigmask(SIG_BLOCK, set, NULL)) {
+        PERROR("pthread_sigmask failed\n");
+        free(sc);
+        return NULL;
+    }
+    if ((sc->fd = signalfd(-1, set, SFD_NONBLOCK | SFD_CLOEXEC)) == -1) {
+        PERROR("signalfd failed\n");
+        free(sc);
+        return NULL;
+    }
+    Chan *chan;
+    if (!(chan = chan_create(sizeof(struct signalfd_siginfo)))) {
+        _sigchan_close(sc);
+        return NULL;
+    }
+    source_init(&sc->src, chan, _sigchan_read, _sigchan_idle, _sigchan_free);
+    sc->sched      = sched;
+    sc->is_watched = 0;
+
+    sc->wait.fd     = sc->fd;
+    sc->wait.events = EPOLLIN;
+    sc->wait.fxn    = _sigchan_ready;
+    sc->wait.arg    = sc;
+    if (io_addwatch(poller, &sc->wait)) {
+        chan->source = NULL;
+        chan_free(chan);
+        _sigchan_close(sc);
+        return NULL;
+    }
+    sc->is_watched = 1;
+
+    PDEBUG("SIGCHAN created\n");
+
+    return chan;
+}
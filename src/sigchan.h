@@ -0,0 +1,29 @@
+
+#ifndef SIGCHAN_H__
+#define SIGCHAN_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <signal.h>
+#include <sys/signalfd.h>
+
+#include "internal.h"
+
+/*
+ * Signals of a chan, read from a signalfd in the poller of the
+ * scheduler. While records are pending, the relay of the source
+ * writes them, and the fd is not watched meanwhile.
+ */
+struct SigChan {
+    ChanSource  src;
+
+    int       fd;
+    IoWait    wait;
+    int       is_watched;
+    /* record read, while the relay writes it */
+    struct signalfd_siginfo  info;
+
+    struct Scheduler  *sched;
+};
+
+#endif /* SIGCHAN_H__ */
@@ -0,0 +1,85 @@
+
+#include <stdlib.h>
+
+#include "internal.h"
+
+/* the relay PROC, writing the data of src until none is left */
+static
+void _source_relay(void)
+{
+    ChanSource *src = ((void **)proc_self()->args.ptr)[0];
+
+    void *data;
+    while (!src->is_closed && (data = src->next(src))) {
+        if (chan_write(src->chan, data, src->chan->data_size) < 0) {
+            break;
+        }
+    }
+
+    src->relay = NULL;
+    if (src->is_closed) {
+        src->free(src);
+        return;
+    }
+    if (src->idle) {
+        src->idle(src);
+    }
+}
+
+/* sets up src as the source of chan */
+void source_init(ChanSource *src, Chan *chan,
+                 void* (*next)(ChanSource *src),
+                 void (*idle)(ChanSource *src),
+                 void (*free)(ChanSource *src))
+{
+    ASSERT_NOTNULL(src);
+    ASSERT_NOTNULL(chan);
+
+    src->chan      = chan;
+    src->next      = next;
+    src->idle      = idle;
+    src->free      = free;
+    src->relay     = NULL;
+    src->is_closed = 0;
+    chan->source   = src;
+}
+
+/* starts the relay of src if none runs, returns 0 on success */
+int source_start(ChanSource *src)
+{
+    ASSERT_NOTNULL(src);
+
+    if (src->relay) {
+        return 0;
+    }
+    Proc *proc;
+    if (proc_create(&proc, _source_relay)) {
+        return -1;
+    }
+    proc_setarg(proc, src);
+    if (proc_prepare(proc)) {
+        PERROR("proc_prepare failed for ChanSource\n");
+        proc_free(proc);
+        return -1;
+    }
+    src->relay = proc;
+    scheduler_addready(proc);
+    return 0;
+}
+
+/*
+ * Called as the chan of src is freed, once poisoned. A relay still
+ * running is resumed by the poison, or cancelled out of a wait in
+ * next, and frees src as it ends.
+ */
+void source_free(ChanSource *src)
+{
+    ASSERT_NOTNULL(src);
+
+    if (src->relay) {
+        src->is_closed = 1;
+        proc_cancel(src->relay);
+        return;
+    }
+    src->free(src);
+}
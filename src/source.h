@@ -0,0 +1,31 @@
+
+#ifndef SOURCE_H__
+#define SOURCE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "internal.h"
+
+/*
+ * Data written to a chan by a relay PROC of its own, from a source
+ * which the chan frees with it. A source embeds this first, and
+ * gives its hooks to source_init.
+ */
+struct ChanSource {
+    struct Chan  *chan;
+
+    /* data to write next, or NULL while none is left */
+    void*  (*next)(struct ChanSource *src);
+    /* called as the relay ends while chan is open, may be NULL */
+    void  (*idle)(struct ChanSource *src);
+    /* frees the source, once chan is freed and no relay runs */
+    void  (*free)(struct ChanSource *src);
+
+    /* relay PROC, while one runs */
+    struct Proc  *relay;
+    /* set once chan is freed, the relay then frees the source */
+    int  is_closed;
+};
+
+#endif /* SOURCE_H__ */
@@ -0,0 +1,93 @@
+
+#include <stdlib.h>
+#include <errno.h>
+
+#include "internal.h"
+
+/*
+ * Sets the tick following the one read at now_us. Missed ticks are
+ * skipped, or coalesced into the last passed which is due at once.
+ */
+static
+void _ticker_next(Ticker *tk, uint64_t now_us)
+{
+    uint64_t next = tk->tick + tk->period;
+    if (next > now_us) {
+        tk->tick = next;
+        return;
+    }
+    /* the last multiple of period which has passed */
+    uint64_t last = now_us - (now_us - tk->tick) % tk->period;
+    tk->tick = (tk->policy == PROXC_TICK_COALESCE)
+             ? last
+             : last + tk->period;
+}
+
+/* yields each tick of the source, as it is due */
+static
+void* _ticker_read(ChanSource *src)
+{
+    Ticker *tk = (Ticker *)src;
+
+    if (!tk->is_first) {
+        if (tk->period == 0) {
+            return NULL;
+        }
+        _ticker_next(tk, gettimestamp());
+    }
+    if (tk->tick > gettimestamp()) {
+        proc_sleepuntil(src->relay, tk->tick);
+        if (src->is_closed) {
+            return NULL;
+        }
+    }
+    tk->is_first = 0;
+    return &tk->tick;
+}
+
+static
+void _ticker_free(ChanSource *src)
+{
+    free(src);
+}
+
+/*
+ * Opens a chan of uint64_t, which yields the timestamp of each tick
+ * at a multiple of period, or of the single tick at deadline if
+ * period is 0. Ticks are due at absolute times, so the time spent
+ * by the reader between reads does not drift them.
+ */
+Chan* ticker_create(uint64_t period, uint64_t deadline, int policy)
+{
+    Ticker *tk;
+    if (!(tk = malloc(sizeof(Ticker)))) {
+        PERROR("malloc failed for Ticker\n");
+        return NULL;
+    }
+    Chan *chan;
+    if (!(chan = chan_create(sizeof(uint64_t)))) {
+        free(tk);
+        return NULL;
+    }
+    tk->period   = period;
+    tk->policy   = policy;
+    tk->is_first = 1;
+
+    if (period > 0) {
+        uint64_t now_us = gettimestamp();
+        deadline = now_us - now_us % period + period;
+    }
+    tk->tick = deadline;
+
+    source_init(&tk->src, chan, _ticker_read, NULL, _ticker_free);
+    if (source_start(&tk->src)) {
+        chan->source = NULL;
+        chan_free(chan);
+        free(tk);
+        return NULL;
+    }
+
+    PDEBUG("TICKER created\n");
+
+    return chan;
+}
@@ -0,0 +1,26 @@
+
+#ifndef TICKER_H__
+#define TICKER_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "internal.h"
+
+/*
+ * Ticks of a chan, at absolute multiples of period, or once at a
+ * deadline if period is 0. The relay of the source, for the life
+ * of the ticker, sleeps until each tick is due and writes it.
+ */
+struct Ticker {
+    ChanSource  src;
+
+    uint64_t  period;
+    int       policy;
+    /* timestamp of the tick written, or due next */
+    uint64_t  tick;
+    /* set until the first tick is written */
+    int       is_first;
+};
+
+#endif /* TICKER_H__ */
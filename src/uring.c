@@ -0,0 +1,256 @@
+
+#ifdef PROXC_IO_URING
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/epoll.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+
+#include "internal.h"
+
+static inline
+int _uring_setup(unsigned entries, struct io_uring_params *params)
+{
+    return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static inline
+int _uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags)
+{
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static void _uring_ready(void *arg);
+
+/*
+ * Returns NULL if io_uring is not available, such as on older
+ * kernels or when denied by seccomp, and file I/O then falls
+ * back to the plain syscalls.
+ */
+Uring* uring_create(Scheduler *sched)
+{
+    ASSERT_NOTNULL(sched);
+
+    Poller *poller = io_poller(sched);
+    if (!poller) {
+        return NULL;
+    }
+
+    Uring *uring;
+    if (!(uring = calloc(1, sizeof(Uring)))) {
+        PERROR("calloc failed for Uring\n");
+        return NULL;
+    }
+
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    if ((uring->fd = _uring_setup(URING_ENTRIES, &params)) == -1) {
+        PDEBUG("io_uring_setup failed\n");
+        free(uring);
+        return NULL;
+    }
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP)) {
+        PDEBUG("io_uring without single mmap\n");
+        close(uring->fd);
+        free(uring);
+        return NULL;
+    }
+    uring->entries = params.sq_entries;
+
+    size_t sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    size_t cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    uring->ring_size = (sq_size > cq_size) ? sq_size : cq_size;
+    uring->ring = mmap(NULL, uring->ring_size, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, uring->fd, IORING_OFF_SQ_RING);
+    uring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    uring->sqes = mmap(NULL, uring->sqes_size, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, uring->fd, IORING_OFF_SQES);
+    if (uring->ring == MAP_FAILED || uring->sqes == MAP_FAILED) {
+        PERROR("mmap failed for Uring\n");
+        if (uring->ring != MAP_FAILED) munmap(uring->ring, uring->ring_size);
+        if (uring->sqes != MAP_FAILED) munmap(uring->sqes, uring->sqes_size);
+        close(uring->fd);
+        free(uring);
+        return NULL;
+    }
+
+    char *ring = uring->ring;
+    uring->sq.head  = (unsigned *)(ring + params.sq_off.head);
+    uring->sq.tail  = (unsigned *)(ring + params.sq_off.tail);
+    uring->sq.mask  = (unsigned *)(ring + params.sq_off.ring_mask);
+    uring->sq.array = (unsigned *)(ring + params.sq_off.array);
+    uring->cq.head  = (unsigned *)(ring + params.cq_off.head);
+    uring->cq.tail  = (unsigned *)(ring + params.cq_off.tail);
+    uring->cq.mask  = (unsigned *)(ring + params.cq_off.ring_mask);
+    uring->cq.cqes  = (struct io_uring_cqe *)(ring + params.cq_off.cqes);
+
+    uring->num_pending  = 0;
+    uring->num_inflight = 0;
+    uring->num_rounds   = 0;
+    TAILQ_INIT(&uring->waitQ);
+
+    /* the scheduler sleeps in epoll, which wakes on completions */
+    uring->ring_wait.fd     = uring->fd;
+    uring->ring_wait.events = EPOLLIN;
+    uring->ring_wait.fxn    = _uring_ready;
+    uring->ring_wait.arg    = uring;
+    if (io_addsource(poller, &uring->ring_wait)) {
+        PERROR("epoll failed for Uring\n");
+        munmap(uring->sqes, uring->sqes_size);
+        munmap(uring->ring, uring->ring_size);
+        close(uring->fd);
+        free(uring);
+        return NULL;
+    }
+
+    PDEBUG("URING created with %u entries\n", uring->entries);
+
+    return uring;
+}
+
+void uring_free(Scheduler *sched, Uring *uring)
+{
+    if (!uring) return;
+
+    io_remsource(sched->poller, &uring->ring_wait);
+    munmap(uring->sqes, uring->sqes_size);
+    munmap(uring->ring, uring->ring_size);
+    close(uring->fd);
+    free(uring);
+}
+
+static
+void _uring_reap(Uring *uring)
+{
+    unsigned head = *uring->cq.head;
+    unsigned tail = __atomic_load_n(uring->cq.tail, __ATOMIC_ACQUIRE);
+    if (head == tail) {
+        return;
+    }
+
+    for (; head != tail; ++head) {
+        struct io_uring_cqe *cqe = &uring->cq.cqes[head & *uring->cq.mask];
+        struct UringOp *op = (struct UringOp *)(uintptr_t)cqe->user_data;
+        op->res = cqe->res;
+        scheduler_addready(op->proc);
+        --uring->num_inflight;
+
+        /* a freed entry lets a PROC waiting on one queue its op */
+        Proc *proc = TAILQ_FIRST(&uring->waitQ);
+        if (proc) {
+            TAILQ_REMOVE(&uring->waitQ, proc, readyQ_next);
+            scheduler_addready(proc);
+        }
+    }
+    __atomic_store_n(uring->cq.head, head, __ATOMIC_RELEASE);
+
+    PDEBUG("URING reaped completions\n");
+}
+
+static
+void _uring_ready(void *arg)
+{
+    _uring_reap((Uring *)arg);
+}
+
+static
+void _uring_submit(Uring *uring)
+{
+    int ret = _uring_enter(uring->fd, (unsigned)uring->num_pending, 0, 0);
+    if (ret == -1) {
+        /* EAGAIN and EBUSY are retried at the next flush */
+        if (errno != EAGAIN && errno != EBUSY && errno != EINTR) {
+            PERROR("io_uring_enter failed\n");
+        }
+        return;
+    }
+    uring->num_pending -= (size_t)ret;
+    uring->num_rounds   = 0;
+}
+
+/*
+ * Called by the scheduler each round. Completions are reaped
+ * without a syscall, while queued operations are submitted in
+ * one batch when no PROC is ready, or after IO_POLL_ROUNDS
+ * rounds, so operations of all PROCs in a round share it.
+ */
+void uring_flush(Uring *uring, int is_idle)
+{
+    ASSERT_NOTNULL(uring);
+
+    if (uring->num_inflight > uring->num_pending) {
+        _uring_reap(uring);
+    }
+    if (uring->num_pending > 0
+        && (is_idle || ++uring->num_rounds >= IO_POLL_ROUNDS)) {
+        _uring_submit(uring);
+    }
+}
+
+/*
+ * Queues an operation and parks until it completes. Returns the
+ * result, with negative errno as for io_uring. The buffers are
+ * written by the kernel until then, so the wait is not
+ * interrupted when the PROC is cancelled.
+ */
+static
+int _uring_op(Uring *uring, uint8_t opcode, int fd, const void *addr,
+              unsigned len, uint64_t off, unsigned flags)
+{
+    Proc *proc = proc_self();
+
+    /* in flight is bounded by the entries, so the CQ never overflows */
+    while (uring->num_inflight == uring->entries) {
+        TAILQ_INSERT_TAIL(&uring->waitQ, proc, readyQ_next);
+        proc->state = PROC_URINGWAIT;
+        proc_yield(proc);
+    }
+
+    struct UringOp op = { .res = 0, .proc = proc };
+
+    unsigned tail = *uring->sq.tail;
+    unsigned idx  = tail & *uring->sq.mask;
+    struct io_uring_sqe *sqe = &uring->sqes[idx];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode      = opcode;
+    sqe->fd          = fd;
+    sqe->addr        = (uint64_t)(uintptr_t)addr;
+    sqe->len         = len;
+    sqe->off         = off;
+    sqe->fsync_flags = flags;
+    sqe->user_data   = (uint64_t)(uintptr_t)&op;
+    uring->sq.array[idx] = idx;
+    __atomic_store_n(uring->sq.tail, tail + 1, __ATOMIC_RELEASE);
+
+    ++uring->num_pending;
+    ++uring->num_inflight;
+
+    PDEBUG("URING op queued, park\n");
+
+    /* yield until the completion is reaped */
+    proc->state = PROC_URINGWAIT;
+    proc_yield(proc);
+    return op.res;
+}
+
+ssize_t uring_preadv(Uring *uring, int fd, const struct iovec *iov, int num, off_t off)
+{
+    return _uring_op(uring, IORING_OP_READV, fd, iov, (unsigned)num, (uint64_t)off, 0);
+}
+
+ssize_t uring_pwritev(Uring *uring, int fd, const struct iovec *iov, int num, off_t off)
+{
+    return _uring_op(uring, IORING_OP_WRITEV, fd, iov, (unsigned)num, (uint64_t)off, 0);
+}
+
+int uring_fsync(Uring *uring, int fd, int is_datasync)
+{
+    return _uring_op(uring, IORING_OP_FSYNC, fd, NULL, 0, 0,
+                     is_datasync ? IORING_FSYNC_DATASYNC : 0);
+}
+
+#endif /* PROXC_IO_URING */
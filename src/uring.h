@@ -0,0 +1,61 @@
+
+#ifndef URING_H__
+#define URING_H__
+
+#ifdef PROXC_IO_URING
+
+#include <stddef.h>
+#include <stdint.h>
+#include <linux/io_uring.h>
+
+#include "internal.h"
+
+/* number of submission entries of each ring */
+#define URING_ENTRIES  64
+
+/* an operation of a parked PROC, res is set on completion */
+struct UringOp {
+    int          res;
+    struct Proc  *proc;
+};
+
+/* io_uring instance of a scheduler, created at the first operation */
+struct Uring {
+    int       fd;
+    unsigned  entries;
+
+    /* rings are mapped together, with the entries separately */
+    void    *ring;
+    size_t  ring_size;
+    struct io_uring_sqe  *sqes;
+    size_t  sqes_size;
+
+    struct {
+        unsigned  *head;
+        unsigned  *tail;
+        unsigned  *mask;
+        unsigned  *array;
+    } sq;
+    struct {
+        unsigned  *head;
+        unsigned  *tail;
+        unsigned  *mask;
+        struct io_uring_cqe  *cqes;
+    } cq;
+
+    /* queued and not submitted, and submitted and not completed */
+    size_t  num_pending;
+    size_t  num_inflight;
+    /* scheduling rounds since the first pending was queued */
+    size_t  num_rounds;
+
+    /* the ring fd in the poller, readable when completions are */
+    IoWait  ring_wait;
+
+    /* PROCs waiting on a free entry */
+    struct ProcQ  waitQ;
+};
+
+#endif /* PROXC_IO_URING */
+
+#endif /* URING_H__ */
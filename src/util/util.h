@@ -4,6 +4,7 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <string.h>
 #include <sys/time.h>
 
 static inline
@@ -14,6 +15,19 @@ uint64_t gettimestamp(void)
     return (uint64_t)tv.tv_sec * (uint64_t)1000000 + (uint64_t)tv.tv_usec;
 }
 
+static inline
+void copydata(void *dst, const void *src, size_t size)
+{
+    switch (size) {
+    case 0:    /* do nothing */                         break;
+    case 1:   *(uint8_t *)dst =  *(const uint8_t *)src; break;
+    case 2:  *(uint16_t *)dst = *(const uint16_t *)src; break;
+    case 4:  *(uint32_t *)dst = *(const uint32_t *)src; break;
+    case 8:  *(uint64_t *)dst = *(const uint64_t *)src; break;
+    default: memcpy(dst, src, size); break;
+    }
+}
+
 #if defined(__GNUC__) || defined(__llvm__)
 
 #   define LIKELY(x)    __builtin_expect(!!(x), 1)
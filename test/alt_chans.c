@@ -0,0 +1,68 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+
+#include <proxc.h>
+
+#define NUM_WORKERS  1000
+#define NUM_OPS      100000L
+
+void worker(void)
+{
+    Chan *ch = ARGN(0);
+    long id = (long)(void *)ARGN(1);
+
+    while (CHWRITE(ch, &id, long) > 0)
+        ;
+}
+
+void foofunc(void)
+{
+    static Chan *chs[NUM_WORKERS];
+    static long stats[NUM_WORKERS];
+
+    for (long i = 0; i < NUM_WORKERS; i++) {
+        chs[i] = CHOPEN(long);
+        GO(PROC(worker, chs[i], (void *)i));
+    }
+    YIELD();
+
+    long value;
+    clock_t start, stop;
+    start = clock();
+    for (long i = 0; i < NUM_OPS; i++) {
+        int key = ALT_CHANS(chs, NUM_WORKERS, &value, long);
+        if (key != value) {
+            printf("mismatch: key %d, value %ld\n", key, value);
+        }
+        stats[key]++;
+        /* disable every other chan halfway through */
+        if (i == NUM_OPS / 2) {
+            for (long j = 0; j < NUM_WORKERS; j += 2) {
+                CHPOISON(chs[j]);
+                chs[j] = NULL;
+            }
+        }
+    }
+    stop = clock();
+    double time_ms = (stop - start) * 1000.0 / CLOCKS_PER_SEC;
+
+    long min = NUM_OPS, max = 0;
+    for (long i = 1; i < NUM_WORKERS; i += 2) {
+        if (stats[i] < min) min = stats[i];
+        if (stats[i] > max) max = stats[i];
+    }
+    printf("Num chans:    %d\n", NUM_WORKERS);
+    printf("Num alts:     %ld\n", NUM_OPS);
+    printf("Reads/chan:   %ld - %ld\n", min, max);
+    printf("Time:         %fms\n", time_ms);
+    printf("us/alt:       %fus\n", time_ms * 1000.0 / (double)NUM_OPS);
+}
+
+int main(void)
+{
+    proxc_start(foofunc);
+    return 0;
+}
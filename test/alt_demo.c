@@ -10,18 +10,22 @@ void worker(void)
 { 
     Chan *chint = ARGN(0);
     int id = *(int *)ARGN(1);
+    Chan *done = ARGN(2);
     
     printf("worker %d: start\n", id);
 
     int value = id * 3;
     for (;;) {
         printf("worker %d: trying to write %d\n", id, value);
-        CHWRITE(chint, &value, int);
+        if (CHWRITE(chint, &value, int) < 0) {
+            break;
+        }
         printf("worker %d: succeded\n", id);
         SLEEP(MSEC(100));
     }
 
     printf("worker %d: stop\n", id);
+    CHWRITE(done, &id, int);
 }
 
 void foofunc(void)
@@ -31,21 +35,27 @@ void foofunc(void)
     enum { NUM_WORKERS = 3 };
     Chan *chs[NUM_WORKERS];
     int ids[NUM_WORKERS];
+    Chan *done = CHOPEN(int);
     for (int i = 0; i < NUM_WORKERS; i++) {
         chs[i] = CHOPEN(int);
         ids[i] = i;
-        GO(PROC(worker, chs[i], &ids[i]));
+        GO(PROC(worker, chs[i], &ids[i], done));
     }
     YIELD();
 
     int x = 2, y = 4;
     int val1 = 0, val2 = 0, val3 = 0;
+    int is_poisoned = 0;
     for (int i = 0; i < 10; i++) {
         printf("foofunc: round %d\n", i);
+        /* worker 2 stops halfway, and the ALT reports it */
+        if (i == 5) {
+            CHPOISON(chs[2]);
+        }
         switch (ALT(
             CHAN_GUARD(i < y, chs[0], &val1, int),
             CHAN_GUARD(i > x, chs[1], &val2, int),
-            CHAN_GUARD(    1, chs[2], &val3, int),
+            CHAN_GUARD(!is_poisoned, chs[2], &val3, int),
             TIME_GUARD(    1, MSEC(500)),
             SKIP_GUARD(1)
         )) {
@@ -64,12 +74,26 @@ void foofunc(void)
         case 4: // guard 4
             printf("\tguard 4 accepted\n");
             break;
+        case PROXC_EPOISON:
+            printf("\tguard %d poisoned\n", ALT_POISONED());
+            is_poisoned = 1;
+            break;
         }
         SLEEP(MSEC(333));
     }
 
+    for (int i = 0; i < NUM_WORKERS; i++)
+        CHPOISON(chs[i]);
+
+    /* wait for the poisoned workers to stop */
+    for (int i = 0; i < NUM_WORKERS; i++) {
+        int id;
+        CHREAD(done, &id, int);
+    }
+
     for (int i = 0; i < NUM_WORKERS; i++)
         CHCLOSE(chs[i]);
+    CHCLOSE(done);
 
     printf("foofunc: stop\n");
 }
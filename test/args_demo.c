@@ -0,0 +1,61 @@
+
+#include <stdio.h>
+#include <string.h>
+
+#include <proxc.h>
+
+struct Point {
+    int  x;
+    int  y;
+};
+
+/* too large to fit in the PROC, stored on top of its stack */
+struct Buffer {
+    char  text[200];
+    int   len;
+};
+
+void point(void)
+{
+    struct Point p = ARGS(struct Point);
+    printf("point: (%d, %d)\n", p.x, p.y);
+}
+
+void buffer(void)
+{
+    struct Buffer *buf = &ARGS(struct Buffer);
+    printf("buffer: %.*s\n", buf->len, buf->text);
+}
+
+void spawned(void)
+{
+    int n = ARGS(int);
+    printf("spawned: %d\n", n);
+}
+
+void proxc(void)
+{
+    struct Buffer buf;
+    buf.len = snprintf(buf.text, sizeof(buf.text), "copied by value");
+
+    GO(proxc_procargs(buffer, &buf, sizeof(buf)));
+    /* args are copied, so this is not seen by buffer */
+    memset(&buf, 0, sizeof(buf));
+
+    RUN(PAR(
+            PROC_ARGS(point, struct Point, .x = 1, .y = 2),
+            PROC_ARGS(point, struct Point, 3, 4)
+        )
+    );
+
+    for (int i = 0; i < 3; i++) {
+        SPAWN_ARGS(spawned, int, i);
+    }
+    YIELD();
+}
+
+int main(void)
+{
+    proxc_start(proxc);
+    return 0;
+}
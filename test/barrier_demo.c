@@ -0,0 +1,75 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+
+#include <proxc.h>
+
+#define NUM_WORKERS 4
+#define NUM_PHASES  3
+
+void worker(void)
+{
+    Barrier *bar = ARGN(0);
+    int id = *(int *)ARGN(1);
+
+    for (int phase = 0; phase < NUM_PHASES; phase++) {
+        printf("worker %d: phase %d\n", id, phase);
+        SLEEP(MSEC(10 * id));
+        SYNC(bar);
+    }
+    /* the last phase is done without this worker */
+    RESIGN(bar);
+    printf("worker %d: resigned\n", id);
+}
+
+void watcher(void)
+{
+    Barrier *bar = ARGN(0);
+
+    for (int phase = 0; phase <= NUM_PHASES; ) {
+        switch (ALT(
+            BAR_GUARD(1, bar),
+            TIME_GUARD(1, MSEC(15))
+        )) {
+        case 0:
+            printf("watcher: phase %d done\n", phase++);
+            break;
+        case 1:
+            printf("watcher: waiting on phase %d\n", phase);
+            break;
+        }
+    }
+}
+
+void foofunc(void)
+{
+    /* workers and watcher, and the final SYNC below */
+    Barrier *bar = BAROPEN(NUM_WORKERS + 2);
+
+    int ids[NUM_WORKERS] = { 1, 2, 3, 4 };
+    GO(PAR(
+           PROC(watcher, bar),
+           PROC(worker, bar, &ids[0]),
+           PROC(worker, bar, &ids[1]),
+           PROC(worker, bar, &ids[2]),
+           PROC(worker, bar, &ids[3])
+       )
+    );
+
+    for (int phase = 0; phase <= NUM_PHASES; phase++) {
+        SYNC(bar);
+    }
+    printf("foofunc: all phases done\n");
+
+    /* let watcher finish */
+    YIELD();
+    BARCLOSE(bar);
+}
+
+int main(void)
+{
+    proxc_start(foofunc);
+    return 0;
+}
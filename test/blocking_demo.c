@@ -0,0 +1,74 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/time.h>
+
+#include <proxc.h>
+
+#define NUM_CALLERS  4
+
+static long now_ms(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec * 1000L + tv.tv_usec / 1000L;
+}
+
+/* blocks the thread it runs on */
+void* slow_square(void *arg)
+{
+    long val = (long)arg;
+    usleep(20 * 1000);
+    return (void *)(val * val);
+}
+
+void* resolve(void *arg)
+{
+    struct addrinfo *res = NULL;
+    int ret = getaddrinfo((const char *)arg, NULL, NULL, &res);
+    if (res) freeaddrinfo(res);
+    return (void *)(long)ret;
+}
+
+void caller(void)
+{
+    long id = (long)ARGN(0);
+    long result = (long)BLOCKING(slow_square, (void *)id);
+    printf("caller %ld: %ld\n", id, result);
+}
+
+/* keeps running while the callers are parked */
+void ticker(void)
+{
+    for (int i = 0; i < 3; ++i) {
+        SLEEP(MSEC(5));
+        printf("tick %d\n", i);
+    }
+}
+
+void foofunc(void)
+{
+    long start = now_ms();
+    RUN(PAR(
+            PROC(caller, (void *)1L),
+            PROC(caller, (void *)2L),
+            PROC(caller, (void *)3L),
+            PROC(caller, (void *)4L),
+            PROC(ticker)
+        )
+    );
+    long elapsed = now_ms() - start;
+    printf("calls overlapped: %s\n", (elapsed < NUM_CALLERS * 20) ? "yes" : "no");
+
+    long ret = (long)BLOCKING(resolve, "localhost");
+    printf("getaddrinfo: %s\n", ret ? gai_strerror((int)ret) : "ok");
+}
+
+int main(void)
+{
+    proxc_start(foofunc);
+    return 0;
+}
@@ -0,0 +1,100 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+
+#include <proxc.h>
+
+#define NUM_CLIENTS 4
+#define NUM_CALLS   5
+
+void client(void)
+{
+    Call *square = ARGN(0);
+    Call *negate = ARGN(1);
+    int id = *(int *)ARGN(2);
+
+    for (int i = 0; i < NUM_CALLS; i++) {
+        int req = id * 10 + i, resp;
+        if (i % 2) {
+            CALL(square, &req, int, &resp, int);
+            printf("client %d: square(%d) = %d\n", id, req, resp);
+        }
+        else {
+            CALL(negate, &req, int, &resp, int);
+            printf("client %d: negate(%d) = %d\n", id, req, resp);
+        }
+    }
+}
+
+void server(void)
+{
+    Call *square = ARGN(0);
+    Call *negate = ARGN(1);
+
+    int req, resp;
+    for (;;) {
+        switch (ALT(
+            CALL_GUARD(1, square, &req, int),
+            CALL_GUARD(1, negate, &req, int)
+        )) {
+        case 0:
+            resp = req * req;
+            REPLY(square, &resp, int);
+            break;
+        case 1:
+            resp = -req;
+            REPLY(negate, &resp, int);
+            break;
+        }
+    }
+}
+
+void echoer(void)
+{
+    Call *echo = ARGN(0);
+
+    for (int i = 0; i < NUM_CALLS; i++) {
+        int resp;
+        CALL(echo, &i, int, &resp, int);
+        printf("echoer: echo(%d) = %d\n", i, resp);
+    }
+}
+
+void foofunc(void)
+{
+    Call *square = CALLOPEN(int, int);
+    Call *negate = CALLOPEN(int, int);
+
+    GO(PROC(server, square, negate));
+
+    int ids[NUM_CLIENTS] = { 0, 1, 2, 3 };
+    RUN(PAR(
+            PROC(client, square, negate, &ids[0]),
+            PROC(client, square, negate, &ids[1]),
+            PROC(client, square, negate, &ids[2]),
+            PROC(client, square, negate, &ids[3])
+        )
+    );
+
+    CALLCLOSE(square);
+    CALLCLOSE(negate);
+
+    /* plain ACCEPT and REPLY, without ALT */
+    Call *echo = CALLOPEN(int, int);
+    GO(PROC(echoer, echo));
+    for (int i = 0; i < NUM_CALLS; i++) {
+        int req, resp;
+        ACCEPT(echo, &req, int);
+        resp = req;
+        REPLY(echo, &resp, int);
+    }
+    CALLCLOSE(echo);
+}
+
+int main(void)
+{
+    proxc_start(foofunc);
+    return 0;
+}
@@ -0,0 +1,185 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <proxc.h>
+
+/* blocks forever on a chan nobody writes to */
+void reader(void)
+{
+    Chan *ch = ARGN(0);
+    int val;
+    int ret = CHREAD(ch, &val, int);
+    printf("reader: %d\n", ret);
+}
+
+void sleeper(void)
+{
+    SLEEP(MSEC(1000));
+    printf("sleeper: cancelled %d\n", CANCELLED());
+}
+
+void alter(void)
+{
+    Chan *ch = ARGN(0);
+    int val;
+    int key = ALT(
+        CHAN_GUARD(1, ch, &val, int),
+        TIME_GUARD(1, MSEC(1000))
+    );
+    printf("alter: %d\n", key);
+}
+
+/* blocks on a CALL, barrier, lock or future nobody completes */
+void caller(void)
+{
+    Call *call = ARGN(0);
+    int req = 1, resp;
+    printf("caller: %d\n", CALL(call, &req, int, &resp, int));
+}
+
+void syncer(void)
+{
+    Barrier *bar = ARGN(0);
+    printf("syncer: %d\n", SYNC(bar));
+}
+
+void locker(void)
+{
+    Mutex *mtx = ARGN(0);
+    printf("locker: %d\n", MTXLOCK(mtx));
+}
+
+void semwaiter(void)
+{
+    Sem *sem = ARGN(0);
+    printf("semwaiter: %d\n", SEMWAIT(sem));
+}
+
+void condwaiter(void)
+{
+    Cond *cond = ARGN(0);
+    Mutex *mtx = ARGN(1);
+    MTXLOCK(mtx);
+    int ret = CONDWAIT(cond, mtx);
+    MTXUNLOCK(mtx);
+    printf("condwaiter: %d\n", ret);
+}
+
+void awaiter(void)
+{
+    Future *fut = ARGN(0);
+    printf("awaiter: %d\n", AWAIT(fut, NULL, int));
+}
+
+void step(void)
+{
+    long id = (long)ARGN(0);
+    printf("step %ld\n", id);
+    SLEEP(MSEC(20));
+}
+
+void napper(void)
+{
+    SLEEP(MSEC(500));
+    printf("napper: cancelled %d\n", CANCELLED());
+}
+
+void quick(void)
+{
+}
+
+/* a RUN in a PROC which may be run inline by the RUN of its parent */
+void nester(void)
+{
+    RUN(PROC(quick));
+    SLEEP(MSEC(500));
+}
+
+void parent(void)
+{
+    RUN(PAR(PROC(napper), PROC(nester)));
+}
+
+void foofunc(void)
+{
+    Chan *ch = CHOPEN(int);
+
+    /* a deadline on a RUN tree wakes its blocked PROCs */
+    int ret = RUN(DEADLINE(PAR(
+            PROC(reader, ch),
+            PROC(sleeper),
+            PROC(alter, ch)
+        ), MSEC(10))
+    );
+    printf("run: %d\n", ret);
+
+    /* steps of a SEQ not started when cancelled are skipped */
+    ret = RUN(DEADLINE(SEQ(
+            PROC(step, (void *)0L),
+            PROC(step, (void *)1L),
+            PROC(step, (void *)2L),
+            PROC(step, (void *)3L)
+        ), MSEC(30))
+    );
+    printf("seq: %d\n", ret);
+
+    /* as are PROCs waiting on a CALL, barrier, lock or future */
+    Call *call = CALLOPEN(int, int);
+    Barrier *bar = BAROPEN(2);
+    Mutex *mtx = MTXOPEN();
+    Mutex *cond_mtx = MTXOPEN();
+    Sem *sem = SEMOPEN(0);
+    Cond *cond = CONDOPEN();
+    Future *other = GO_FUTURE(PROC(reader, ch), int);
+    MTXLOCK(mtx);
+    ret = RUN(DEADLINE(PAR(
+            PROC(caller, call),
+            PROC(syncer, bar),
+            PROC(locker, mtx),
+            PROC(semwaiter, sem),
+            PROC(condwaiter, cond, cond_mtx),
+            PROC(awaiter, other)
+        ), MSEC(10))
+    );
+    printf("waits: %d\n", ret);
+    MTXUNLOCK(mtx);
+    CANCEL(other);
+    AWAIT(other, NULL, int);
+    FUTFREE(other);
+    CONDCLOSE(cond);
+    SEMCLOSE(sem);
+    MTXCLOSE(cond_mtx);
+    MTXCLOSE(mtx);
+    BARCLOSE(bar);
+    CALLCLOSE(call);
+
+    /* a GO tree is cancelled by its future */
+    Future *fut = GO_FUTURE(PAR(PROC(reader, ch), PROC(sleeper)), int);
+    SLEEP(MSEC(10));
+    printf("cancel: %d\n", CANCEL(fut));
+    printf("await: %d\n", AWAIT(fut, NULL, int));
+    printf("cancel again: %d\n", CANCEL(fut));
+    FUTFREE(fut);
+
+    /* a cancel reaches the whole tree, also past a nested RUN */
+    fut = GO_FUTURE(PROC(parent), int);
+    SLEEP(MSEC(20));
+    uint64_t start = TIMER();
+    CANCEL(fut);
+    AWAIT(fut, NULL, int);
+    printf("nested await: %s\n", (TIMER() - start < MSEC(100)) ? "prompt" : "late");
+    FUTFREE(fut);
+
+    /* a deadline not reached has no effect */
+    ret = RUN(DEADLINE(PROC(step, (void *)4L), MSEC(100)));
+    printf("run: %d\n", ret);
+
+    CHCLOSE(ch);
+}
+
+int main(void)
+{
+    proxc_start(foofunc);
+    return 0;
+}
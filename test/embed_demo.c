@@ -0,0 +1,98 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+
+#include <proxc.h>
+
+#define NUM_MSGS  5
+
+void ticker(void)
+{
+    for (int i = 0; i < 3; ++i) {
+        SLEEP(MSEC(20));
+        printf("proc tick %d\n", i);
+    }
+}
+
+void writer(void)
+{
+    int fd = (int)(long)ARGN(0);
+    for (long i = 0; i < NUM_MSGS; ++i) {
+        SLEEP(MSEC(10));
+        proxc_write(fd, &i, sizeof(i));
+    }
+    close(fd);
+}
+
+void reader(void)
+{
+    int fd = (int)(long)ARGN(0);
+    long val, sum = 0;
+    while (proxc_read(fd, &val, sizeof(val)) == sizeof(val)) {
+        sum += val;
+    }
+    printf("reader: sum %ld\n", sum);
+    close(fd);
+}
+
+int main(void)
+{
+    if (proxc_init()) {
+        fprintf(stderr, "proxc_init failed\n");
+        return 1;
+    }
+
+    int pipefd[2];
+    if (pipe(pipefd)) {
+        perror("pipe");
+        return 1;
+    }
+    SPAWN(ticker, NULL);
+    GO(PAR(
+            PROC(reader, (void *)(long)pipefd[0]),
+            PROC(writer, (void *)(long)pipefd[1])
+        )
+    );
+
+    /* the loop of the application, with a timer of its own */
+    int epfd = epoll_create1(EPOLL_CLOEXEC);
+    int tfd  = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    struct itimerspec its = {
+        .it_interval = { .tv_sec = 0, .tv_nsec = 25 * 1000 * 1000 },
+        .it_value    = { .tv_sec = 0, .tv_nsec = 25 * 1000 * 1000 }
+    };
+    timerfd_settime(tfd, 0, &its, NULL);
+
+    struct epoll_event ev = { .events = EPOLLIN };
+    ev.data.fd = tfd;
+    epoll_ctl(epfd, EPOLL_CTL_ADD, tfd, &ev);
+    ev.data.fd = proxc_fd();
+    epoll_ctl(epfd, EPOLL_CTL_ADD, ev.data.fd, &ev);
+
+    int num_ticks = 0;
+    while (proxc_poll(MSEC(1))) {
+        int64_t usec = proxc_next_deadline();
+        int timeout_ms = (usec < 0) ? -1 : (int)((usec + 999) / 1000);
+
+        struct epoll_event events[2];
+        int num = epoll_wait(epfd, events, 2, timeout_ms);
+        for (int i = 0; i < num; ++i) {
+            if (events[i].data.fd == tfd) {
+                uint64_t expired;
+                if (read(tfd, &expired, sizeof(expired)) == sizeof(expired)) {
+                    ++num_ticks;
+                }
+            }
+        }
+    }
+    printf("app ticks: %s\n", (num_ticks > 0) ? "yes" : "no");
+
+    close(tfd);
+    close(epfd);
+    proxc_fini();
+    return 0;
+}
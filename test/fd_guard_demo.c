@@ -0,0 +1,102 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+
+#include <proxc.h>
+
+#define NUM_MSGS  3
+
+/* waits on a socket, a control chan and a timeout at once */
+void handler(void)
+{
+    int fd = (int)(long)ARGN(0);
+    Chan *ctrl = ARGN(1);
+
+    int cmd;
+    for (;;) {
+        switch (ALT(
+            FD_GUARD(1, fd, POLLIN),
+            CHAN_GUARD(1, ctrl, &cmd, int),
+            TIME_GUARD(1, MSEC(15))
+        )) {
+        case 0: {
+            char c;
+            ssize_t num = proxc_read(fd, &c, 1);
+            if (num <= 0) {
+                printf("handler: socket closed\n");
+                return;
+            }
+            printf("handler: read '%c'\n", c);
+            break;
+        }
+        case 1:
+            printf("handler: command %d\n", cmd);
+            if (cmd == 0) return;
+            break;
+        case 2:
+            printf("handler: idle\n");
+            break;
+        }
+    }
+}
+
+void sender(void)
+{
+    int fd = (int)(long)ARGN(0);
+    Chan *ctrl = ARGN(1);
+
+    for (int i = 0; i < NUM_MSGS; ++i) {
+        char c = (char)('a' + i);
+        SLEEP(MSEC(5));
+        proxc_write(fd, &c, 1);
+    }
+    int cmd = 1;
+    CHWRITE(ctrl, &cmd, int);
+
+    /* let the handler go idle once, then stop it */
+    SLEEP(MSEC(25));
+    cmd = 0;
+    CHWRITE(ctrl, &cmd, int);
+}
+
+void closer(void)
+{
+    int fd = (int)(long)ARGN(0);
+    SLEEP(MSEC(5));
+    close(fd);
+}
+
+void foofunc(void)
+{
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds)) {
+        perror("socketpair");
+        return;
+    }
+    Chan *ctrl = CHOPEN(int);
+
+    RUN(PAR(
+            PROC(handler, (void *)(long)fds[0], ctrl),
+            PROC(sender, (void *)(long)fds[1], ctrl)
+        )
+    );
+
+    /* a hangup makes the guard ready */
+    RUN(PAR(
+            PROC(handler, (void *)(long)fds[0], ctrl),
+            PROC(closer, (void *)(long)fds[1])
+        )
+    );
+
+    close(fds[0]);
+    CHCLOSE(ctrl);
+}
+
+int main(void)
+{
+    proxc_start(foofunc);
+    return 0;
+}
@@ -0,0 +1,82 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include <proxc.h>
+
+#define NUM_READERS  4
+#define BLOCK_SIZE   4096
+#define NUM_BLOCKS   64
+
+/* reads every NUM_READERS'th block of the file, and checks it */
+void reader(void)
+{
+    int fd = (int)(long)ARGN(0);
+    long id = (long)ARGN(1);
+
+    /* blocks are not put on the small PROC stack */
+    char *buf = malloc(BLOCK_SIZE);
+    long num_ok = 0;
+    for (long i = id; i < NUM_BLOCKS; i += NUM_READERS) {
+        ssize_t num = proxc_pread(fd, buf, BLOCK_SIZE, i * BLOCK_SIZE);
+        if (num == BLOCK_SIZE && buf[0] == (char)i && buf[BLOCK_SIZE - 1] == (char)i) {
+            ++num_ok;
+        }
+    }
+    printf("reader %ld: %ld blocks ok\n", id, num_ok);
+    free(buf);
+}
+
+/* keeps running while the readers wait on the file */
+void counter(void)
+{
+    long count = 0;
+    for (int i = 0; i < 100; ++i) {
+        ++count;
+        YIELD();
+    }
+    printf("counter: %ld\n", count);
+}
+
+void foofunc(void)
+{
+    char path[] = "/tmp/proxc_file_demoXXXXXX";
+    int fd = mkstemp(path);
+    if (fd == -1) {
+        perror("mkstemp");
+        return;
+    }
+    unlink(path);
+
+    char *block = malloc(BLOCK_SIZE);
+    for (long i = 0; i < NUM_BLOCKS; ++i) {
+        memset(block, (char)i, BLOCK_SIZE);
+        if (proxc_pwrite(fd, block, BLOCK_SIZE, i * BLOCK_SIZE) != BLOCK_SIZE) {
+            perror("pwrite");
+            break;
+        }
+    }
+    free(block);
+    if (proxc_fdatasync(fd)) {
+        perror("fdatasync");
+    }
+
+    RUN(PAR(
+            PROC(reader, (void *)(long)fd, (void *)0L),
+            PROC(reader, (void *)(long)fd, (void *)1L),
+            PROC(reader, (void *)(long)fd, (void *)2L),
+            PROC(reader, (void *)(long)fd, (void *)3L),
+            PROC(counter)
+        )
+    );
+    close(fd);
+}
+
+int main(void)
+{
+    proxc_start(foofunc);
+    return 0;
+}
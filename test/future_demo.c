@@ -0,0 +1,103 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <proxc.h>
+
+#define NUM_WORKERS  4
+#define NUM_VALUES   1000
+
+/* sums its part of the values, as the result of its future */
+void worker(void)
+{
+    long *values = ARGN(0);
+    long num = (long)ARGN(1);
+
+    long sum = 0;
+    for (long i = 0; i < num; ++i) {
+        sum += values[i];
+        if (i % 100 == 0) YIELD();
+    }
+    RESULT(&sum, long);
+}
+
+void slow(void)
+{
+    SLEEP(MSEC(50));
+    int done = 1;
+    RESULT(&done, int);
+}
+
+/* PROCs of a PAR share the same future, any of them may set it */
+void half(void)
+{
+    long val = (long)ARGN(0);
+    if (val) RESULT(&val, long);
+}
+
+/* a RESULT from a tree RUN within that of the future */
+void nested(void)
+{
+    RUN(SEQ(PROC(half, (void *)0L), PROC(half, (void *)7L)));
+}
+
+void foofunc(void)
+{
+    static long values[NUM_VALUES];
+    for (long i = 0; i < NUM_VALUES; ++i) {
+        values[i] = i + 1;
+    }
+
+    /* scatter */
+    Future *futs[NUM_WORKERS];
+    long part = NUM_VALUES / NUM_WORKERS;
+    for (long i = 0; i < NUM_WORKERS; ++i) {
+        futs[i] = GO_FUTURE(PROC(worker, &values[i * part], (void *)part), long);
+    }
+
+    /* gather */
+    long total = 0;
+    for (long i = 0; i < NUM_WORKERS; ++i) {
+        long sum;
+        AWAIT(futs[i], &sum, long);
+        printf("worker %ld: %ld\n", i, sum);
+        total += sum;
+        FUTFREE(futs[i]);
+    }
+    printf("total: %ld\n", total);
+
+    /* ALT on a future, with a timeout */
+    Future *fut = GO_FUTURE(PROC(slow), int);
+    int done = 0;
+    for (;;) {
+        int key = ALT(
+            FUTURE_GUARD(1, fut, &done, int),
+            TIME_GUARD(1, MSEC(20))
+        );
+        if (key == 0) break;
+        printf("slow: not done yet\n");
+    }
+    printf("slow: done %d\n", done);
+    FUTFREE(fut);
+
+    fut = GO_FUTURE(PAR(PROC(half, (void *)0L), PROC(half, (void *)42L)), long);
+    long val;
+    AWAIT(fut, &val, long);
+    printf("par: %ld\n", val);
+    FUTFREE(fut);
+
+    fut = GO_FUTURE(PROC(nested), long);
+    AWAIT(fut, &val, long);
+    printf("nested: %ld\n", val);
+    FUTFREE(fut);
+
+    /* a future may be freed before done, the result is discarded */
+    FUTFREE(GO_FUTURE(PROC(slow), int));
+    SLEEP(MSEC(60));
+}
+
+int main(void)
+{
+    proxc_start(foofunc);
+    return 0;
+}
@@ -0,0 +1,96 @@
+
+/*
+ * Run with the interposition library, built with -DPROXC_HOOK=ON:
+ *
+ *   gcc hook_demo.c -lproxc -o hook_demo
+ *   LD_PRELOAD=libproxc_hook.so ./hook_demo
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+
+#include <proxc.h>
+
+static long now_ms(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec * 1000L + tv.tv_usec / 1000L;
+}
+
+/* stands in for code which knows nothing of proxc */
+static void legacy_nap(void)
+{
+    usleep(50 * 1000);
+}
+
+static void legacy_send(int fd, const char *msg)
+{
+    usleep(10 * 1000);
+    write(fd, msg, strlen(msg) + 1);
+}
+
+static void legacy_recv(int fd, char *buf, size_t size)
+{
+    struct pollfd pfd = { .fd = fd, .events = POLLIN };
+    if (poll(&pfd, 1, 1000) == 1) {
+        read(fd, buf, size);
+    }
+}
+
+void napper(void)
+{
+    legacy_nap();
+}
+
+void sender(void)
+{
+    legacy_send((int)(long)ARGN(0), (const char *)ARGN(1));
+}
+
+void receiver(void)
+{
+    char buf[32] = "";
+    legacy_recv((int)(long)ARGN(0), buf, sizeof(buf));
+    printf("received: %s\n", buf);
+}
+
+void foofunc(void)
+{
+    long start = now_ms();
+    RUN(PAR(PROC(napper), PROC(napper)));
+    if (now_ms() - start >= 100) {
+        printf("naps did not overlap, run with LD_PRELOAD=libproxc_hook.so\n");
+        return;
+    }
+    printf("naps overlapped\n");
+
+    /* receivers run first, and park in their read and poll */
+    int pipefd[2], sockfd[2];
+    if (pipe(pipefd) || socketpair(AF_UNIX, SOCK_STREAM, 0, sockfd)) {
+        perror("pipe");
+        return;
+    }
+    RUN(PAR(
+            PROC(receiver, (void *)(long)pipefd[0]),
+            PROC(receiver, (void *)(long)sockfd[0]),
+            PROC(sender, (void *)(long)pipefd[1], "over pipe"),
+            PROC(sender, (void *)(long)sockfd[1], "over socket")
+        )
+    );
+    close(pipefd[0]);
+    close(pipefd[1]);
+    close(sockfd[0]);
+    close(sockfd[1]);
+}
+
+int main(void)
+{
+    proxc_start(foofunc);
+    return 0;
+}
@@ -0,0 +1,71 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include <proxc.h>
+
+#define NUM_THREADS  4
+#define NUM_MSGS     1000
+
+/* a thread of the application, which knows nothing of PROCs */
+static void* producer(void *arg)
+{
+    Chan *ch = arg;
+    for (long i = 1; i <= NUM_MSGS; ++i) {
+        if (INJECT(ch, &i)) {
+            fprintf(stderr, "proxc_inject failed\n");
+            break;
+        }
+    }
+    return NULL;
+}
+
+void greeter(void)
+{
+    printf("posted: %s\n", (const char *)ARGN(0));
+}
+
+static void* poster(void *arg)
+{
+    (void)arg;
+    usleep(10 * 1000);
+    if (POST(greeter, "hello from a thread")) {
+        fprintf(stderr, "proxc_post failed\n");
+    }
+    return NULL;
+}
+
+void foofunc(void)
+{
+    Chan *ch = CHOPEN(long);
+
+    pthread_t threads[NUM_THREADS + 1];
+    for (int i = 0; i < NUM_THREADS; ++i) {
+        pthread_create(&threads[i], NULL, producer, ch);
+    }
+    pthread_create(&threads[NUM_THREADS], NULL, poster, NULL);
+
+    long val, sum = 0;
+    for (int i = 0; i < NUM_THREADS * NUM_MSGS; ++i) {
+        CHREAD(ch, &val, long);
+        sum += val;
+    }
+    long expected = NUM_THREADS * (long)NUM_MSGS * (NUM_MSGS + 1) / 2;
+    printf("sum %ld, expected %ld\n", sum, expected);
+
+    /* joining blocks this thread, but all writes have been read */
+    for (int i = 0; i <= NUM_THREADS; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+    /* give the posted PROC a chance to run */
+    SLEEP(MSEC(10));
+    CHCLOSE(ch);
+}
+
+int main(void)
+{
+    proxc_start(foofunc);
+    return 0;
+}
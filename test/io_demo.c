@@ -0,0 +1,126 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#include <proxc.h>
+
+#define NUM_CLIENTS  4
+#define NUM_MSGS     5
+
+/* echoes everything read from a connection until it is closed */
+void echo(void)
+{
+    int fd = (int)(long)ARGN(0);
+    char buf[64];
+    ssize_t num;
+    while ((num = proxc_read(fd, buf, sizeof(buf))) > 0) {
+        proxc_write(fd, buf, (size_t)num);
+    }
+    close(fd);
+}
+
+void server(void)
+{
+    int lfd = (int)(long)ARGN(0);
+    for (int i = 0; i < NUM_CLIENTS; ++i) {
+        int fd = proxc_accept(lfd, NULL, NULL);
+        if (fd == -1) {
+            perror("accept");
+            return;
+        }
+        SPAWN(echo, (void *)(long)fd);
+    }
+}
+
+void client(void)
+{
+    long id = (long)ARGN(0);
+    struct sockaddr_in *addr = ARGN(1);
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (proxc_connect(fd, (struct sockaddr *)addr, sizeof(*addr)) == -1) {
+        perror("connect");
+        close(fd);
+        return;
+    }
+
+    for (int i = 0; i < NUM_MSGS; ++i) {
+        char msg[32], buf[32];
+        int len = snprintf(msg, sizeof(msg), "client %ld msg %d", id, i);
+        proxc_write(fd, msg, (size_t)len);
+        ssize_t num = proxc_read(fd, buf, sizeof(buf) - 1);
+        buf[num > 0 ? num : 0] = '\0';
+        if (strcmp(msg, buf)) {
+            printf("client %ld: mismatch '%s'\n", id, buf);
+        }
+    }
+    printf("client %ld: done\n", id);
+    close(fd);
+}
+
+/* runs on the same scheduler, while the others wait on I/O */
+void ticker(void)
+{
+    for (int i = 0; i < 3; ++i) {
+        SLEEP(MSEC(5));
+        printf("tick %d\n", i);
+    }
+}
+
+/* blocks on a pipe nobody writes to, until its deadline */
+void reader(void)
+{
+    int fd = (int)(long)ARGN(0);
+    char c;
+    ssize_t num = proxc_read(fd, &c, 1);
+    printf("pipe read: %zd, %s\n", num, (num == -1) ? strerror(errno) : "");
+}
+
+void foofunc(void)
+{
+    int lfd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port        = 0;
+    socklen_t len = sizeof(addr);
+    if (bind(lfd, (struct sockaddr *)&addr, sizeof(addr)) || listen(lfd, 16)
+        || getsockname(lfd, (struct sockaddr *)&addr, &len)) {
+        perror("listen");
+        return;
+    }
+
+    RUN(PAR(
+            PROC(server, (void *)(long)lfd),
+            PROC(client, (void *)0L, &addr),
+            PROC(client, (void *)1L, &addr),
+            PROC(client, (void *)2L, &addr),
+            PROC(client, (void *)3L, &addr),
+            PROC(ticker)
+        )
+    );
+    close(lfd);
+
+    int fds[2];
+    if (pipe(fds)) {
+        perror("pipe");
+        return;
+    }
+    int ret = RUN(DEADLINE(PROC(reader, (void *)(long)fds[0]), MSEC(10)));
+    printf("run: %d\n", ret);
+    close(fds[0]);
+    close(fds[1]);
+}
+
+int main(void)
+{
+    proxc_start(foofunc);
+    return 0;
+}
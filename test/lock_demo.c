@@ -0,0 +1,86 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+
+#include <proxc.h>
+
+#define NUM_PRODUCERS 3
+#define NUM_ITEMS     1000
+#define BUF_SIZE      4
+
+struct Buffer {
+    Mutex  *mtx;
+    Cond   *not_empty;
+    Sem    *slots;
+    int    items[BUF_SIZE];
+    size_t head, num;
+};
+
+void producer(void)
+{
+    struct Buffer *buf = ARGN(0);
+    int id = *(int *)ARGN(1);
+
+    for (int i = 0; i < NUM_ITEMS; i++) {
+        SEMWAIT(buf->slots);
+        MTXLOCK(buf->mtx);
+        buf->items[(buf->head + buf->num++) % BUF_SIZE] = id;
+        CONDSIGNAL(buf->not_empty);
+        MTXUNLOCK(buf->mtx);
+        if (i % 7 == 0) YIELD();
+    }
+}
+
+void consumer(void)
+{
+    struct Buffer *buf = ARGN(0);
+
+    long stats[NUM_PRODUCERS] = { 0 };
+    for (int i = 0; i < NUM_PRODUCERS * NUM_ITEMS; i++) {
+        MTXLOCK(buf->mtx);
+        while (buf->num == 0) {
+            CONDWAIT(buf->not_empty, buf->mtx);
+        }
+        int id = buf->items[buf->head];
+        buf->head = (buf->head + 1) % BUF_SIZE;
+        buf->num--;
+        MTXUNLOCK(buf->mtx);
+        SEMPOST(buf->slots);
+        stats[id]++;
+    }
+
+    for (int i = 0; i < NUM_PRODUCERS; i++)
+        printf("producer %d: %ld items\n", i, stats[i]);
+}
+
+void foofunc(void)
+{
+    struct Buffer buf = {
+        .mtx       = MTXOPEN(),
+        .not_empty = CONDOPEN(),
+        .slots     = SEMOPEN(BUF_SIZE),
+        .head      = 0,
+        .num       = 0
+    };
+
+    int ids[NUM_PRODUCERS] = { 0, 1, 2 };
+    RUN(PAR(
+            PROC(consumer, &buf),
+            PROC(producer, &buf, &ids[0]),
+            PROC(producer, &buf, &ids[1]),
+            PROC(producer, &buf, &ids[2])
+        )
+    );
+
+    MTXCLOSE(buf.mtx);
+    CONDCLOSE(buf.not_empty);
+    SEMCLOSE(buf.slots);
+}
+
+int main(void)
+{
+    proxc_start(foofunc);
+    return 0;
+}
@@ -0,0 +1,70 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#include <proxc.h>
+
+#define NUM_TICKS  10
+
+static long now_ms(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec * 1000L + tv.tv_usec / 1000L;
+}
+
+/* a plain blocking call, which stalls the thread it runs on */
+void blocker(void)
+{
+    Chan *ch = (Chan *)ARGN(0);
+    usleep(200 * 1000);
+    printf("blocker: slept\n");
+
+    /* spinning without calls into proxc stalls it as well */
+    long start = now_ms();
+    while (now_ms() - start < 100)
+        ;
+    printf("blocker: spun\n");
+
+    int val = 42;
+    CHWRITE(ch, &val, int);
+}
+
+void ticker(void)
+{
+    Chan *ch = (Chan *)ARGN(0);
+    long start = now_ms();
+    for (int i = 0; i < NUM_TICKS; ++i) {
+        SLEEP(MSEC(10));
+    }
+    long elapsed = now_ms() - start;
+    printf("ticker: %d ticks, kept running: %s\n", NUM_TICKS,
+           (elapsed < 200) ? "yes" : "no");
+
+    int val;
+    CHREAD(ch, &val, int);
+    printf("ticker: read %d\n", val);
+}
+
+void foofunc(void)
+{
+    MONITOR(MSEC(20));
+    /* enabling again only sets the threshold */
+    MONITOR(MSEC(20));
+
+    Chan *ch = CHOPEN(int);
+    RUN(PAR(
+            PROC(ticker, ch),
+            PROC(blocker, ch)
+        )
+    );
+    CHCLOSE(ch);
+}
+
+int main(void)
+{
+    proxc_start(foofunc);
+    return 0;
+}
@@ -6,27 +6,46 @@
 void generate(void)
 {
     Chan *chlong = ARGN(0);
+    Chan *done = ARGN(1);
 
     long i = 2;
-    for (;;) {
-        CHWRITE(chlong, &i, long);
+    while (CHWRITE(chlong, &i, long) > 0) {
         i++;
     }
+
+    /* tell that chlong is no longer used */
+    CHWRITE(done, &i, long);
 }
 
+struct FilterArgs {
+    Chan  *in_chlong;
+    Chan  *out_chlong;
+    Chan  *done;
+    long  prime;
+};
+
 void filter(void)
 {
-    Chan *in_chlong = ARGN(0);
-    Chan *out_chlong = ARGN(1);
-    long prime = (long)(long *)ARGN(2);
+    struct FilterArgs args = ARGS(struct FilterArgs);
+    Chan *in_chlong = args.in_chlong;
+    Chan *out_chlong = args.out_chlong;
+    long prime = args.prime;
     
     long i;
     for (;;) {
-        CHREAD(in_chlong, &i, long);
-        if (i % prime != 0) {
-            CHWRITE(out_chlong, &i, long);
+        if (CHREAD(in_chlong, &i, long) < 0) {
+            break;
+        }
+        if (i % prime != 0 && CHWRITE(out_chlong, &i, long) < 0) {
+            break;
         }
     }
+
+    /* propagate poison both ways */
+    CHPOISON(in_chlong);
+    CHPOISON(out_chlong);
+
+    CHWRITE(args.done, &prime, long);
 }
 
 void proxc(void)
@@ -36,22 +55,34 @@ void proxc(void)
     Chan *chs[PRIME+1];
     chs[0] = CHOPEN(long);
 
+    Chan *done = CHOPEN(long);
     Chan *chlong = chs[0];
-    GO(PROC(generate, chlong));
+    GO(PROC(generate, chlong, done));
     long prime = 0;
     for (long i = 0; i < PRIME; i++) {
         CHREAD(chlong, &prime, long);
         //printf("%ld: %ld\n", i, prime);
         chs[i+1] = CHOPEN(long);
         Chan *new_chlong = chs[i+1];
-        GO(PROC(filter, chlong, new_chlong, (void *)prime));
+        GO(PROC_ARGS(filter, struct FilterArgs, chlong, new_chlong, done, prime));
         chlong = new_chlong;
     }
     printf("prime %d: %ld\n", PRIME, prime);
 
+    /* the last filter is blocked writing to chlong, and */
+    /* the poison propagates back through to generate */
+    CHPOISON(chlong);
+
+    /* wait for generate and every filter to stop */
+    long last;
+    for (int i = 0; i <= PRIME; i++) {
+        CHREAD(done, &last, long);
+    }
+
     for (int i = 0; i <= PRIME; i++) {
         CHCLOSE(chs[i]);
     }
+    CHCLOSE(done);
 }
 
 int main(void) 
@@ -0,0 +1,78 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/signalfd.h>
+
+#include <proxc.h>
+
+void producer(void)
+{
+    Chan *work = ARGN(0);
+    for (int i = 0; ; ++i) {
+        if (CHWRITE(work, &i, int) < 0) {
+            break;
+        }
+        SLEEP(MSEC(5));
+    }
+}
+
+/* stands in for an operator, reloading and then stopping the program */
+void operator(void)
+{
+    SLEEP(MSEC(30));
+    kill(getpid(), SIGHUP);
+    SLEEP(MSEC(30));
+    kill(getpid(), SIGUSR1);
+    SLEEP(MSEC(30));
+    kill(getpid(), SIGTERM);
+}
+
+void foofunc(void)
+{
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGHUP);
+    sigaddset(&set, SIGUSR1);
+    sigaddset(&set, SIGTERM);
+    Chan *sigs = SIGNAL_CHAN(&set);
+    if (!sigs) {
+        fprintf(stderr, "proxc_signal_chan failed\n");
+        return;
+    }
+
+    Chan *work = CHOPEN(int);
+    GO(PROC(producer, work));
+    GO(PROC(operator));
+
+    struct signalfd_siginfo info;
+    int item, num_items = 0;
+    for (int is_running = 1; is_running; ) {
+        switch (ALT(
+            CHAN_GUARD(1, sigs, &info, struct signalfd_siginfo),
+            CHAN_GUARD(1, work, &item, int)
+        )) {
+        case 0:
+            printf("signal %s\n", strsignal((int)info.ssi_signo));
+            if (info.ssi_signo == SIGTERM) {
+                is_running = 0;
+            }
+            break;
+        case 1:
+            ++num_items;
+            break;
+        }
+    }
+    printf("worked on items: %s\n", (num_items > 0) ? "yes" : "no");
+
+    CHCLOSE(work);
+    CHCLOSE(sigs);
+}
+
+int main(void)
+{
+    proxc_start(foofunc);
+    return 0;
+}
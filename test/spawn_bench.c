@@ -0,0 +1,93 @@
+
+#include <stdio.h>
+#include <time.h>
+
+#include <proxc.h>
+
+#define NUM_PROCS  1000000L
+
+static long counter = 0;
+
+void worker(void)
+{
+    counter += (long)(void *)ARGN(0);
+}
+
+static
+double bench_go(void)
+{
+    clock_t start = clock();
+    for (long i = 0; i < NUM_PROCS; ++i) {
+        GO( PROC(worker, (void *)1L) );
+        YIELD();
+    }
+    clock_t stop = clock();
+    return (double)(stop - start) / CLOCKS_PER_SEC;
+}
+
+static
+double bench_spawn(void)
+{
+    clock_t start = clock();
+    for (long i = 0; i < NUM_PROCS; ++i) {
+        SPAWN(worker, (void *)1L);
+        YIELD();
+    }
+    clock_t stop = clock();
+    return (double)(stop - start) / CLOCKS_PER_SEC;
+}
+
+static
+double bench_run(void)
+{
+    clock_t start = clock();
+    for (long i = 0; i < NUM_PROCS; ++i) {
+        RUN( PROC(worker, (void *)1L) );
+    }
+    clock_t stop = clock();
+    return (double)(stop - start) / CLOCKS_PER_SEC;
+}
+
+void pworker(void)
+{
+    counter += *(long *)ARGN(0);
+}
+
+static
+double bench_parn(void)
+{
+    enum { NUM_PAR = 10000 };
+    static long ones[NUM_PAR];
+    for (long i = 0; i < NUM_PAR; ++i) {
+        ones[i] = 1;
+    }
+
+    clock_t start = clock();
+    for (long i = 0; i < NUM_PROCS / NUM_PAR; ++i) {
+        RUN( PAR_N(NUM_PAR, pworker, ones, sizeof(long)) );
+    }
+    clock_t stop = clock();
+    return (double)(stop - start) / CLOCKS_PER_SEC;
+}
+
+static
+void report(const char *name, double diff)
+{
+    printf("%-8s %.2fms, %.2fns / proc\n", name, diff * 1000.0,
+           diff * 1000.0 * 1000.0 * 1000.0 / NUM_PROCS);
+}
+
+void foofunc(void)
+{
+    report("GO:", bench_go());
+    report("SPAWN:", bench_spawn());
+    report("RUN:", bench_run());
+    report("PAR_N:", bench_parn());
+    printf("Num procs run: %ld\n", counter);
+}
+
+int main(void)
+{
+    proxc_start(foofunc);
+    return 0;
+}
@@ -0,0 +1,92 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include <proxc.h>
+
+#define PERIOD     MSEC(20)
+#define NUM_TICKS  5
+
+/* a sampler doing some work each tick, which does not drift the cadence */
+void sampler(void)
+{
+    Chan *ticks = TICKER(PERIOD, PROXC_TICK_SKIP);
+    uint64_t tick, prev = 0;
+    for (int i = 0; i < NUM_TICKS; ++i) {
+        CHREAD(ticks, &tick, uint64_t);
+        printf("sampler: aligned %s, period %s\n",
+               (tick % PERIOD == 0) ? "yes" : "no",
+               (i == 0 || tick - prev == PERIOD) ? "exact" : "off");
+        prev = tick;
+        SLEEP(MSEC(7));
+    }
+    CHCLOSE(ticks);
+}
+
+/* a reader falling behind, which reads the ticks it missed as one */
+void laggard(void)
+{
+    Chan *ticks = TICKER(PERIOD, PROXC_TICK_COALESCE);
+    uint64_t first, late, tick;
+    CHREAD(ticks, &first, uint64_t);
+    SLEEP(3 * PERIOD + MSEC(5));
+
+    /* the tick due while sleeping, then the rest as one at once */
+    CHREAD(ticks, &late, uint64_t);
+    uint64_t start = TIMER();
+    CHREAD(ticks, &tick, uint64_t);
+    printf("laggard: late tick %llu, coalesced up to tick %llu, at once: %s\n",
+           (unsigned long long)((late - first) / PERIOD),
+           (unsigned long long)((tick - first) / PERIOD),
+           (TIMER() - start < PERIOD / 2) ? "yes" : "no");
+    CHCLOSE(ticks);
+}
+
+/* occam style, a loop on absolute deadlines read from the TIMER */
+void stepper(void)
+{
+    uint64_t start = TIMER(), deadline = start;
+    for (int i = 0; i < NUM_TICKS; ++i) {
+        deadline += PERIOD;
+        SLEEP_UNTIL(deadline);
+        SLEEP(MSEC(3));
+    }
+    uint64_t late = TIMER() - deadline;
+    printf("stepper: late by under a period: %s\n", (late < PERIOD) ? "yes" : "no");
+
+    /* a timer chan as the timeout of an ALT on work */
+    Chan *work = CHOPEN(int);
+    Chan *timer = TIMER_CHAN(TIMER() + MSEC(10));
+    int val;
+    uint64_t fired;
+    switch (ALT(
+        CHAN_GUARD(1, work, &val, int),
+        CHAN_GUARD(1, timer, &fired, uint64_t)
+    )) {
+    case 0:
+        printf("stepper: work\n");
+        break;
+    case 1:
+        printf("stepper: timer fired\n");
+        break;
+    }
+    CHCLOSE(timer);
+    CHCLOSE(work);
+}
+
+void foofunc(void)
+{
+    RUN(PAR(
+            PROC(sampler),
+            PROC(laggard),
+            PROC(stepper)
+        )
+    );
+}
+
+int main(void)
+{
+    proxc_start(foofunc);
+    return 0;
+}
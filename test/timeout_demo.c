@@ -0,0 +1,55 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+
+#include <proxc.h>
+
+void slow_writer(void)
+{
+    Chan *ch = ARGN(0);
+
+    for (int value = 0; ; value++) {
+        SLEEP(MSEC(30 * (value % 4)));
+        if (CHWRITE(ch, &value, int) < 0) {
+            break;
+        }
+    }
+}
+
+void foofunc(void)
+{
+    Chan *ch = CHOPEN(int);
+    GO(PROC(slow_writer, ch));
+
+    int value, num_timeouts = 0;
+    for (int i = 0; i < 20; i++) {
+        switch (CHREAD_TIMEOUT(ch, &value, int, MSEC(50))) {
+        case PROXC_ETIMEOUT:
+            printf("read %d: timed out\n", i);
+            num_timeouts++;
+            break;
+        default:
+            printf("read %d: %d\n", i, value);
+            break;
+        }
+    }
+
+    /* no reader, so this always times out */
+    Chan *none = CHOPEN(int);
+    if (CHWRITE_TIMEOUT(none, &value, int, 0) == PROXC_ETIMEOUT) {
+        printf("write: timed out\n");
+    }
+    CHCLOSE(none);
+
+    printf("timeouts: %d\n", num_timeouts);
+    CHCLOSE(ch);
+    YIELD();
+}
+
+int main(void)
+{
+    proxc_start(foofunc);
+    return 0;
+}
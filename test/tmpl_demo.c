@@ -0,0 +1,123 @@
+
+#include <stdio.h>
+#include <time.h>
+
+#include <proxc.h>
+
+#define NUM_BATCHES  10000
+
+struct Batch {
+    long  first;
+    long  num;
+    long  sum;
+    int   verbose;
+};
+
+void producer(void)
+{
+    Chan *ch = ARGN(0);
+    struct Batch *batch = TMPLARG();
+
+    for (long i = 0; i < batch->num; ++i) {
+        long val = batch->first + i;
+        CHWRITE(ch, &val, long);
+    }
+}
+
+void squarer(void)
+{
+    Chan *in = ARGN(0);
+    Chan *out = ARGN(1);
+    struct Batch *batch = TMPLARG();
+
+    for (long i = 0; i < batch->num; ++i) {
+        long val;
+        CHREAD(in, &val, long);
+        val *= val;
+        CHWRITE(out, &val, long);
+    }
+}
+
+void summer(void)
+{
+    Chan *ch = ARGN(0);
+    struct Batch *batch = TMPLARG();
+
+    batch->sum = 0;
+    for (long i = 0; i < batch->num; ++i) {
+        long val;
+        CHREAD(ch, &val, long);
+        batch->sum += val;
+    }
+}
+
+void report(void)
+{
+    struct Batch *batch = TMPLARG();
+    if (!batch->verbose) return;
+    printf("batch %ld..%ld: sum of squares %ld\n",
+           batch->first, batch->first + batch->num - 1, batch->sum);
+}
+
+static
+Builder* network(Chan *a, Chan *b)
+{
+    return SEQ(
+            PAR(
+                PROC(producer, a),
+                PROC(squarer, a, b),
+                PROC(summer, b)
+            ),
+            PROC(report)
+        );
+}
+
+void foofunc(void)
+{
+    Chan *a = CHOPEN(long);
+    Chan *b = CHOPEN(long);
+
+    /* the network is built once */
+    Template *tmpl = TMPLCREATE(network(a, b));
+
+    /* and run with new args, without any allocations */
+    struct Batch batch = { .num = 4, .verbose = 1 };
+    for (long i = 0; i < 3; ++i) {
+        batch.first = i * batch.num;
+        TMPLRUN(tmpl, &batch);
+    }
+    batch.verbose = 0;
+
+    clock_t start = clock();
+    for (long i = 0; i < NUM_BATCHES; ++i) {
+        batch.first = i;
+        TMPLRUN(tmpl, &batch);
+    }
+    clock_t stop = clock();
+    double diff = (double)(stop - start) / CLOCKS_PER_SEC;
+    printf("TMPLRUN: %.2fus / run\n", diff * 1000.0 * 1000.0 / NUM_BATCHES);
+
+    TMPLFREE(tmpl);
+
+    /* compared to building the network for each run */
+    start = clock();
+    for (long i = 0; i < NUM_BATCHES; ++i) {
+        batch.first = i;
+        Builder *net = network(a, b);
+        Template *once = TMPLCREATE(net);
+        TMPLRUN(once, &batch);
+        TMPLFREE(once);
+    }
+    stop = clock();
+    diff = (double)(stop - start) / CLOCKS_PER_SEC;
+    printf("build and run: %.2fus / run\n", diff * 1000.0 * 1000.0 / NUM_BATCHES);
+
+    CHCLOSE(a);
+    CHCLOSE(b);
+}
+
+int main(void)
+{
+    proxc_start(foofunc);
+    return 0;
+}